@@ -0,0 +1,320 @@
+#include "AnalysisServer.hpp"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "BasicEngine.hpp"
+#include "Board.hpp"
+#include "Notation.hpp"
+#include "SearchCache.hpp"
+
+struct AnalysisRequest {
+    uint64_t sequence;
+    std::string id;
+    std::string fen;
+    int depth;
+    int multiPV = 1;
+    bool chess960 = false;
+};
+
+// Minimal reader for the flat JSON objects requests are made of: string,
+// number and boolean values only
+static bool parseRequest(std::string_view text, AnalysisRequest& request) {
+    size_t pos = 0;
+    auto skipSpace = [&]() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) ++pos;
+    };
+    auto readString = [&](std::string& out) {
+        if (pos >= text.size() || text[pos] != '"') return false;
+        for (++pos; pos < text.size() && text[pos] != '"'; ++pos) {
+            if (text[pos] == '\\' && pos + 1 < text.size()) ++pos;
+            out += text[pos];
+        }
+        return pos++ < text.size();
+    };
+
+    skipSpace();
+    if (pos >= text.size() || text[pos++] != '{') return false;
+    while (true) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == '}') return true;
+
+        std::string key, value;
+        if (!readString(key)) return false;
+        skipSpace();
+        if (pos >= text.size() || text[pos++] != ':') return false;
+        skipSpace();
+        if (pos < text.size() && text[pos] == '"') {
+            if (!readString(value)) return false;
+        } else {
+            while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ' ') {
+                value += text[pos++];
+            }
+        }
+
+        if (key == "id") {
+            request.id = value;
+        } else if (key == "fen") {
+            request.fen = value;
+        } else if (key == "depth") {
+            request.depth = std::stoi(value);
+        } else if (key == "multipv") {
+            request.multiPV = std::stoi(value);
+        } else if (key == "chess960") {
+            request.chess960 = (value == "true");
+        }
+
+        skipSpace();
+        if (pos < text.size() && text[pos] == ',') ++pos;
+    }
+}
+
+static std::string jsonString(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string formatResult(const AnalysisRequest& request, const std::vector<SearchLine>& lines,
+                                uint64_t nodes) {
+    std::string out = "{\"id\":" + jsonString(request.id) + ",\"fen\":" + jsonString(request.fen);
+    out += ",\"bestmove\":" + jsonString(lines.empty() ? "0000" : moveToUCI(lines.front().move, request.chess960));
+    out += ",\"lines\":[";
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const SearchLine& line = lines[i];
+        std::string score = BasicEngine::formatScore(line.score);  // "cp 35" / "mate 3"
+        size_t space = score.find(' ');
+        out += (i ? ",{" : "{");
+        out += "\"multipv\":" + std::to_string(i + 1) + ",\"depth\":" + std::to_string(line.depth);
+        out += ",\"score\":{\"" + score.substr(0, space) + "\":" + score.substr(space + 1) + "}";
+        out += ",\"pv\":[";
+        for (size_t j = 0; j < line.pv.size(); ++j) {
+            out += (j ? "," : "") + jsonString(moveToUCI(line.pv[j], request.chess960));
+        }
+        out += "]}";
+    }
+    out += "],\"nodes\":" + std::to_string(nodes) + "}";
+    return out;
+}
+
+static std::string formatError(const AnalysisRequest& request, const std::string& message) {
+    return "{\"id\":" + jsonString(request.id) + ",\"error\":" + jsonString(message) + "}";
+}
+
+// One client's stream of requests, answered by the shared worker pool
+class AnalysisServer {
+public:
+    AnalysisServer(const ServerOptions& options, std::shared_ptr<SearchCache> cache)
+        : options(options), cache(std::move(cache)) {}
+
+    void serve(int inputFd, int outputFd);
+
+private:
+    const ServerOptions& options;
+    std::shared_ptr<SearchCache> cache;
+    int outputFd = -1;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<AnalysisRequest> queue;
+    bool inputDone = false;
+
+    // Results held back until every earlier request has been answered
+    std::mutex outputMutex;
+    std::map<uint64_t, std::string> pending;
+    uint64_t nextToWrite = 0;
+
+    void worker(int index);
+    void emit(uint64_t sequence, std::string line);
+    void writeLine(const std::string& line);
+};
+
+void AnalysisServer::writeLine(const std::string& line) {
+    std::string data = line + "\n";
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = write(outputFd, data.data() + written, data.size() - written);
+        if (count <= 0) return;  // Client went away; keep draining work
+        written += static_cast<size_t>(count);
+    }
+}
+
+void AnalysisServer::emit(uint64_t sequence, std::string line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (!options.ordered) {
+        writeLine(line);
+        return;
+    }
+
+    pending.emplace(sequence, std::move(line));
+    for (auto it = pending.begin(); it != pending.end() && it->first == nextToWrite; it = pending.erase(it)) {
+        writeLine(it->second);
+        ++nextToWrite;
+    }
+}
+
+void AnalysisServer::worker(int index) {
+    // Each worker searches with its own engine and boards; only the cache is
+    // shared. Pinned first, so they are allocated on the worker's own node.
+    NumaTopology::system().bindThread(index, options.numaPolicy);
+    BasicEngine engine(options.depth);
+    engine.setSearchCache(cache);
+
+    while (true) {
+        AnalysisRequest request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return !queue.empty() || inputDone; });
+            if (queue.empty()) return;
+            request = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        std::string result;
+        try {
+            Board board(request.fen);
+            engine.setDepth(std::max(1, request.depth));
+            std::vector<SearchLine> lines = engine.analyze(board, request.multiPV);
+            result = formatResult(request, lines, engine.getNodeCount());
+        } catch (const std::exception& e) {
+            result = formatError(request, e.what());
+        }
+        emit(request.sequence, std::move(result));
+    }
+}
+
+void AnalysisServer::serve(int inputFd, int resultFd) {
+    outputFd = resultFd;
+    inputDone = false;
+    nextToWrite = 0;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::max(1, options.threads); ++i) {
+        workers.emplace_back(&AnalysisServer::worker, this, i);
+    }
+
+    // Read request lines straight from the descriptor
+    std::string buffer;
+    char chunk[65536];
+    uint64_t sequence = 0;
+    ssize_t count;
+    bool more = true;
+    while (more) {
+        count = read(inputFd, chunk, sizeof(chunk));
+        more = count > 0;
+        if (more) buffer.append(chunk, static_cast<size_t>(count));
+        if (!more && !buffer.empty() && buffer.back() != '\n') buffer += '\n';
+
+        size_t start = 0;
+        size_t end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+            std::string_view line(buffer.data() + start, end - start);
+            start = end + 1;
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            AnalysisRequest request;
+            request.sequence = sequence++;
+            request.depth = options.depth;
+            bool valid = true;
+            if (line.front() == '{') {
+                try {
+                    valid = parseRequest(line, request);
+                } catch (const std::exception&) {
+                    valid = false;
+                }
+            } else {
+                request.fen.assign(line);
+            }
+            if (request.id.empty()) request.id = std::to_string(request.sequence + 1);
+
+            if (!valid || request.fen.empty()) {
+                emit(request.sequence, formatError(request, "malformed request"));
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(request));
+            workAvailable.notify_one();
+        }
+        buffer.erase(0, start);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inputDone = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+static int openListeningSocket(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    path.copy(address.sun_path, path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Cannot create socket");
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(fd, 8) == -1) {
+        close(fd);
+        throw std::runtime_error("Cannot listen on " + path);
+    }
+    return fd;
+}
+
+int runAnalysisServer(const ServerOptions& options) {
+    signal(SIGPIPE, SIG_IGN);  // A client hanging up must not end the server
+    auto cache = std::make_shared<SearchCache>();
+    cache->table.setCapacity(options.tableEntries);
+    cache->table.interleave(options.numaPolicy);
+    if (!options.cachePath.empty()) cache->load(options.cachePath);
+
+    AnalysisServer server(options, cache);
+    if (options.socketPath.empty()) {
+        server.serve(STDIN_FILENO, STDOUT_FILENO);
+    } else {
+        // Clients are served one at a time, each with the full worker pool
+        int listener = openListeningSocket(options.socketPath);
+        std::cerr << "Listening on " << options.socketPath << std::endl;
+        while (true) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client == -1) break;
+            server.serve(client, client);
+            close(client);
+            // A failed save keeps the previous snapshot, so keep serving
+            try {
+                if (!options.cachePath.empty()) cache->save(options.cachePath);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        close(listener);
+    }
+
+    if (!options.cachePath.empty()) cache->save(options.cachePath);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef ANALYSIS_SERVER_HPP
+#define ANALYSIS_SERVER_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "Numa.hpp"
+
+struct ServerOptions {
+    int threads = 1;
+    int depth = 5;                  // Used when a request gives no depth
+    size_t tableEntries = 1 << 24;  // Bound on the shared transposition table
+    bool ordered = true;            // Answer in request order; otherwise as finished
+    std::string socketPath;         // Serve a Unix socket instead of stdin/stdout
+    std::string cachePath;          // SearchCache snapshot loaded and saved
+    NumaPolicy numaPolicy = NumaPolicy::Auto;
+};
+
+// Headless batch analysis. Each request line is either a bare FEN or a JSON
+// object such as
+//   {"id": "g1", "fen": "<fen>", "depth": 6, "multipv": 3, "chess960": true}
+// and is searched by a pool of BasicEngine workers sharing one transposition
+// table. Every result is one JSON line tagged with the request id (the line
+// number when none is given).
+int runAnalysisServer(const ServerOptions& options);
+
+#endif  // ANALYSIS_SERVER_HPP
@@ -3,55 +3,188 @@
 
 #include "Engine.hpp"
 #include "Board.hpp"
-#include <unordered_map>
+#include "Evaluation.hpp"
+#include "SearchCache.hpp"
+#include "Tablebase.hpp"
+#include "Trace.hpp"
+#include <memory>
 #include <limits>
 #include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
 
 class BasicEngine : public Engine {
 public:
+    // A side mated n plies from the root scores -(MATE_SCORE - n), so scores
+    // at or beyond MATE_BOUND are forced mates
+    static constexpr int MATE_SCORE = 100000;
+    static constexpr int MATE_BOUND = MATE_SCORE - 1000;
+    // Tablebase wins, likewise less the plies to reach them, rank below any
+    // mate the search finds itself
+    static constexpr int TABLEBASE_WIN = MATE_BOUND - 1000;
+    static constexpr int TABLEBASE_BOUND = TABLEBASE_WIN - 1000;
+
+    explicit BasicEngine(int depth = 5) : depth(depth) {}
+
+    void setDepth(int newDepth) { depth = newDepth; }
+
+    // Searches through a cache that outlives this search: its transposition
+    // table is kept between searches and finished analyses are answered from
+    // it when already searched deep enough
+    void setSearchCache(std::shared_ptr<SearchCache> searchCache) {
+        cache = std::move(searchCache);
+        table = cache ? &cache->table : nullptr;
+        if (cache) ownTable.reset();  // Unused while the cache's table is searched
+    }
+    int getDepth() const { return depth; }
+
+    // Size of the engine's own transposition table (not a shared cache's);
+    // reallocating drops its contents
+    void setHashSize(size_t megabytes) {
+        ownTableMegabytes = megabytes;
+        if (ownTable) ownTable->resize(megabytes);
+    }
+
+    // UCI score text for a root score: "cp 35", or "mate 3" / "mate -2" for
+    // forced mates, counted in moves from the root
+    static std::string formatScore(int score) {
+        if (std::abs(score) < MATE_BOUND) {
+            return "cp " + std::to_string(score);
+        }
+        int plies = MATE_SCORE - std::abs(score);
+        int moves = (plies + 1) / 2;
+        return "mate " + std::to_string(score > 0 ? moves : -moves);
+    }
+
     Move getBestMove(const Board& board) override {
-        int depth = 5;  // You can adjust the depth as needed
-        int alpha = std::numeric_limits<int>::min();
-        int beta = std::numeric_limits<int>::max();
-        int bestScore = alpha;
-        Move bestMove;
-        transpositionTable.clear();
-
-        for (const Move& move : board.moves) {
-            Board tempBoard = board;
-            tempBoard.makeMove(move);
-            int score = -alphaBeta(tempBoard, depth - 1, -beta, -alpha);
-            if (score > bestScore) {
-                bestScore = score;
-                bestMove = move;
-            }
-            alpha = std::max(alpha, bestScore);
+        TRACE_ZONE("BasicEngine::getBestMove");
+        std::vector<SearchLine> lines = analyze(board, 1);
+        return lines.empty() ? Move() : lines.front().move;
+    }
+
+    // One shared search for the top multiPV root moves: a move only has to beat
+    // the current Nth best line, so the extra lines cost a few wider windows
+    // rather than whole separate searches
+    std::vector<SearchLine> analyze(const Board& board, int multiPV) override {
+        // Symmetric window so negating a bound never overflows
+        const int infinity = std::numeric_limits<int>::max();
+        const size_t lineCount = static_cast<size_t>(std::max(1, multiPV));
+        std::vector<SearchLine> lines;  // Best first
+        nodes = 0;
+        tablebaseHits = 0;
+
+        if (cache && cache->analysis.lookup(board, depth, static_cast<int>(lineCount), lines)) {
+            lastScore = lines.front().score;
+            return lines;
+        }
+        if (!cache) {
+            if (!ownTable) ownTable = std::make_unique<TranspositionTable>(ownTableMegabytes);
+            table = ownTable.get();
+            table->clear();
+        }
+
+        // With few pieces left, only search moves that keep the tablebase result
+        std::vector<Move> rootMoves = board.moves;
+        if (tablebasePieceLimit() > 0 && probeRootDTZ(board, rootMoves)) {
+            ++tablebaseHits;
+        }
+
+        // One working copy for the whole search; moves are made and taken back on it
+        Board searchBoard = board;
+        for (const Move& move : rootMoves) {
+            TRACE_ZONE("BasicEngine::rootMove");
+            int alpha = (lines.size() < lineCount) ? -infinity : lines.back().score;
+            SearchUndo undo = searchBoard.makeSearchMove(move);
+            int score = -alphaBeta(searchBoard, depth - 1, 1, -infinity, -alpha);
+            searchBoard.undoSearchMove(undo);
+            if (stopRequested) break;
+            if (score <= alpha) continue;  // Upper bound only, not among the best
+
+            // Equal scores keep the earlier move first
+            auto position = std::find_if(lines.begin(), lines.end(),
+                                         [&](const SearchLine& line) { return line.score < score; });
+            lines.insert(position, SearchLine{move, score, depth, {}});
+            if (lines.size() > lineCount) lines.pop_back();
         }
 
-        return bestMove;
+        for (SearchLine& line : lines) {
+            line.pv = extractPV(board, line.move);
+        }
+        if (cache && !stopRequested) cache->analysis.store(board, lines);
+        lastScore = lines.empty() ? -infinity : lines.front().score;
+        return lines;
     }
 
+    // Score of the move returned by the last getBestMove call, from the point
+    // of view of the side that was to move
+    int getLastScore() const { return lastScore; }
+
+    // Number of alphaBeta nodes visited by the last getBestMove call
+    uint64_t getNodeCount() const { return nodes; }
+
+    // Successful tablebase probes during the last getBestMove call
+    uint64_t getTablebaseHits() const { return tablebaseHits; }
+
 private:
-    struct TTEntry {
-        int depth;
-        int score;
-        int flag;  // 0: Exact, -1: Alpha, 1: Beta
-    };
+    int depth;
+    uint64_t nodes = 0;
+    uint64_t tablebaseHits = 0;
+    int lastScore = 0;
+
+    // Allocated by the first search without a cache, so engines that only
+    // search a shared cache's table never hold one
+    std::unique_ptr<TranspositionTable> ownTable;
+    size_t ownTableMegabytes = TranspositionTable::DEFAULT_MEGABYTES;
+    TranspositionTable* table = nullptr;  // The cache's table when one is set
+    std::shared_ptr<SearchCache> cache;
+
+    // Follows the transposition table's best moves from the position after
+    // first, stopping at the search depth or the first missing or stale entry
+    std::vector<Move> extractPV(const Board& board, const Move& first) {
+        std::vector<Move> pv{first};
+        Board current = board;
+        current.makeMove(first);
+
+        TTEntry entry;
+        while (static_cast<int>(pv.size()) < depth && table->probe(current.computeHash(), entry)) {
+            // Use the legal move itself: entries loaded from a snapshot only
+            // carry the squares and promotion
+            const Move& next = entry.bestMove;
+            auto legal = std::find_if(current.moves.begin(), current.moves.end(), [&](const Move& move) {
+                return move.startSquare == next.startSquare && move.targetSquare == next.targetSquare &&
+                       move.promotionPiece == next.promotionPiece;
+            });
+            if (legal == current.moves.end()) break;
 
-    std::unordered_map<uint64_t, TTEntry> transpositionTable;
+            pv.push_back(*legal);
+            current.makeMove(*legal);
+        }
+        return pv;
+    }
     void sortMoves(Board& board, std::vector<Move>& moves) {
-        std::sort(moves.begin(), moves.end(), [&](const Move& a, const Move& b) {
-            int scoreA = moveOrderingHeuristic(board, a);
-            int scoreB = moveOrderingHeuristic(board, b);
-            return scoreA > scoreB;
+        // Score each move once; the exchange evaluation is too costly to repeat per comparison
+        std::vector<std::pair<int, Move>> scored;
+        scored.reserve(moves.size());
+        for (const Move& move : moves) {
+            scored.emplace_back(moveOrderingHeuristic(board, move), move);
+        }
+        std::sort(scored.begin(), scored.end(), [](const std::pair<int, Move>& a, const std::pair<int, Move>& b) {
+            return a.first > b.first;
         });
+        for (size_t i = 0; i < scored.size(); ++i) {
+            moves[i] = scored[i].second;
+        }
     }
 
     int moveOrderingHeuristic(Board& board, const Move& move) {
         int score = 0;
         // Assign high scores to captures, promotions, and checks
-        if (board.getPieceAt(move.targetSquare) != -1) {
-            score += 1000;  // Capture
+        if (board.getPieceAt(move.targetSquare) != -1 || move.isEnPassant) {
+            // Captures by exchange outcome, losing ones last. They still come
+            // before quiet moves: with no quiescence search the recapture is
+            // often past the horizon, and deferring them searched more nodes.
+            score += 1000 + board.see(move);
         }
         if (move.promotionPiece != 0) {
             score += 800;  // Promotion
@@ -60,79 +193,122 @@ private:
         return score;
     }
 
-    int alphaBeta(Board& board, int depth, int alpha, int beta) {
-        if (depth == 0 || board.isDraw() || board.isCheckmate()) {
-            return evaluate(board);
+    // Mate and tablebase scores count plies from the root, but the table is
+    // shared by searches from other roots and depths, so it holds them
+    // counted from the entry's own position instead
+    static int scoreToTable(int score, int ply) {
+        if (score >= TABLEBASE_BOUND) return score + ply;
+        if (score <= -TABLEBASE_BOUND) return score - ply;
+        return score;
+    }
+    static int scoreFromTable(int score, int ply) {
+        if (score >= TABLEBASE_BOUND) return score - ply;
+        if (score <= -TABLEBASE_BOUND) return score + ply;
+        return score;
+    }
+
+    // ply counts from the root of the search, depth down to the horizon
+    int alphaBeta(Board& board, int depth, int ply, int alpha, int beta) {
+        ++nodes;
+        if (stopRequested.load(std::memory_order_relaxed)) {
+            return 0;  // Aborted; the caller discards the result
+        }
+        if (board.isCheckmate()) {
+            return -MATE_SCORE + ply;  // Mates nearer the root are worse for the loser
+        }
+        if (board.isDraw()) {
+            return 0;
+        }
+
+        TablebaseWDL wdl;
+        if (tablebasePieceLimit() > 0 && probeWDL(board, wdl)) {
+            ++tablebaseHits;
+            switch (wdl) {
+                case TablebaseWin: return TABLEBASE_WIN - ply;  // Prefer wins nearer the root
+                case TablebaseLoss: return -TABLEBASE_WIN + ply;
+                default: return wdl;  // Draws; fifty-move-rule results score just off zero
+            }
+        }
+
+        if (depth == 0) {
+            return evaluate(board) * board.colorTurn;  // Negamax wants the mover's view
         }
 
         uint64_t hash = board.computeHash();
-        if (transpositionTable.count(hash)) {
-            TTEntry entry = transpositionTable[hash];
+        TTEntry entry;
+        if (table->probe(hash, entry)) {
             if (entry.depth >= depth) {
+                int score = scoreFromTable(entry.score, ply);
                 if (entry.flag == 0) {
-                    return entry.score;
-                } else if (entry.flag == -1 && entry.score <= alpha) {
-                    return alpha;
-                } else if (entry.flag == 1 && entry.score >= beta) {
-                    return beta;
+                    return score;
+                } else if (entry.flag == 1 && score <= alpha) {
+                    return alpha;  // Upper bound already below the window
+                } else if (entry.flag == -1 && score >= beta) {
+                    return beta;  // Lower bound already above the window
                 }
             }
         }
 
         int originalAlpha = alpha;
-        int bestScore = std::numeric_limits<int>::min();
+        int bestScore = -std::numeric_limits<int>::max();
+        Move bestMove;
 
-        board.generateMoves();
-        if (board.moves.empty()) {
-            if (board.isKingInCheck(board.colorTurn)) {
-                return -100000 + depth;  // Checkmate detected
+        // Staged generation: captures and promotions (or, in check, the
+        // evasions) first, and quiet moves only if none of those cut off.
+        // Mate and stalemate were already caught by the cached status above.
+        const bool inCheck = board.isKingInCheck(board.colorTurn);
+        std::vector<Move> moveList;
+        for (int stage = 0; stage < 2 && alpha < beta; ++stage) {
+            if (stage == 0) {
+                board.generateLegalMoves(inCheck ? GenerateEvasions : GenerateCaptures, moveList);
+                sortMoves(board, moveList);
+            } else if (!inCheck) {
+                board.generateLegalMoves(GenerateQuiets, moveList);  // All score alike; no sort
             } else {
-                return 0;  // Stalemate detected
+                break;
             }
-        }
-        sortMoves(board, board.moves);
 
-
-        for (Move& move : board.moves) {
-            Board childBoard = board;
-            childBoard.makeMove(move);
-            int score = -alphaBeta(childBoard, depth - 1, -beta, -alpha);
-            bestScore = std::max(bestScore, score);
-            alpha = std::max(alpha, score);
-            if (alpha >= beta) {
-                break;  // Beta cutoff
+            for (const Move& move : moveList) {
+                // Start loading the child's table entry while the move is
+                // made and its status worked out
+                uint64_t childKey = board.keyAfter(move);
+                table->prefetch(childKey);
+                SearchUndo undo = board.makeSearchMove(move, childKey);
+                int score = -alphaBeta(board, depth - 1, ply + 1, -beta, -alpha);
+                board.undoSearchMove(undo);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestMove = move;
+                }
+                alpha = std::max(alpha, score);
+                if (alpha >= beta) {
+                    break;  // Beta cutoff
+                }
             }
         }
+        if (stopRequested.load(std::memory_order_relaxed)) {
+            return 0;  // Keep partial results out of the table
+        }
 
         TTEntry newEntry;
         newEntry.depth = depth;
-        newEntry.score = bestScore;
+        newEntry.score = scoreToTable(bestScore, ply);
+        newEntry.bestMove = bestMove;
         if (bestScore <= originalAlpha) {
-            newEntry.flag = 1;  // Beta cutoff
+            newEntry.flag = 1;  // Upper bound (no move raised alpha)
         } else if (bestScore >= beta) {
-            newEntry.flag = -1;  // Alpha cutoff
+            newEntry.flag = -1;  // Lower bound (beta cutoff)
         } else {
             newEntry.flag = 0;  // Exact value
         }
-        transpositionTable[hash] = newEntry;
+        table->store(hash, newEntry);
 
         return bestScore;
     }
 
+    // Material and piece-square score from white's point of view
     int evaluate(const Board& board) const {
-        static const int pieceValues[12] = {
-            100, 320, 330, 500, 900, 20000,    // White pieces
-            -100, -320, -330, -500, -900, -20000  // Black pieces
-        };
-
-        int score = 0;
-        for (int i = 0; i < 12; ++i) {
-            uint64_t pieces = board.bitboards[i];
-            int pieceCount = __builtin_popcountll(pieces);
-            score += pieceValues[i] * pieceCount;
-        }
-
-        return score;
+        return evaluatePosition(board, defaultEvalWeights());
     }
 };
 
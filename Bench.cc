@@ -0,0 +1,232 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BasicEngine.hpp"
+#include "Board.hpp"
+#include "PerfCounters.hpp"
+#include "SearchCache.hpp"
+
+// Middlegames, endgames and Chess960 starting setups. Keep this list stable:
+// adding or reordering positions changes the bench signature.
+static const char* const benchPositions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+    "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+    "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+    "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+    "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+    "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
+    "3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
+    "2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
+    "4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
+    "2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
+    "1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
+    "8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
+    "1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
+    "8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
+    "3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
+    "1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
+    "q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
+    "r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
+    "r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
+    "r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2R b KQ - 0 12",
+    "rnbqk2r/ppp1bppp/4pn2/3p4/2PP4/2N2N2/PP2PPPP/R1BQKB1R w KQkq - 2 5",
+    "2r3k1/5pp1/p1n1p2p/1p1pP3/3P4/P1N1PN2/1P3PPP/2R3K1 w - - 0 21",
+    "r2q1rk1/pp2ppbp/2np1np1/8/3NP1b1/2N1BP2/PPPQ2PP/R3KB1R b KQ - 0 10",
+    "r1bq1rk1/ppp2ppp/2np1n2/2b1p3/2B1P3/2NP1N2/PPP2PPP/R1BQ1RK1 w - - 0 7",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+    "8/5k2/3p4/1p1Pp2p/pP2Pp1P/P4P1K/8/8 b - - 99 50",
+    "8/8/8/4k3/8/8/3QK3/8 w - - 0 1",
+    "8/8/3k4/8/8/4RK2/8/8 b - - 0 1",
+    "8/8/8/3k4/8/8/3PK3/8 w - - 0 1",
+    "8/1k6/8/8/2N5/2B5/3K4/8 w - - 0 1",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - e3 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9",
+    "2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9",
+    "bbqnnrkr/pppppppp/8/8/8/8/PPPPPPPP/BBQNNRKR w KQkq - 0 1",
+    "qrbnkbrn/pppppppp/8/8/8/8/PPPPPPPP/QRBNKBRN w KQkq - 0 1",
+    "rkrbbnnq/pppppppp/8/8/8/8/PPPPPPPP/RKRBBNNQ w KQkq - 0 1",
+    "nrbkqbnr/pppppppp/8/8/8/8/PPPPPPPP/NRBKQBNR w KQkq - 0 1",
+};
+
+// One huge page; holds every bench search without replacing entries
+static const size_t BENCH_HASH_MEGABYTES = 2;
+
+// The probe timing table is far larger than the TLB covers with 4 KB pages
+static const size_t PROBE_TABLE_MEGABYTES = 256;
+static const int PROBE_COUNT = 1 << 20;
+static const int PREFETCH_DISTANCE = 8;  // Probes ahead, about one search node's worth of work
+
+static volatile int probeSink;
+
+static uint64_t nextKey(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Average nanoseconds per probe of random keys, half of them stored, like
+// the scattered probes of a search. With prefetch set each probe's cluster
+// is requested a few probes early, as the search does for a child.
+static double timeProbes(TranspositionTable& table, bool prefetch) {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    std::vector<uint64_t> keys(PROBE_COUNT);
+    for (uint64_t& key : keys) key = nextKey(state);
+    for (int i = 0; i < PROBE_COUNT; i += 2) table.store(keys[i], TTEntry{1, 0, 0, Move()});
+
+    TTEntry entry;
+    int hits = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < PROBE_COUNT; ++i) {
+        if (prefetch && i + PREFETCH_DISTANCE < PROBE_COUNT) table.prefetch(keys[i + PREFETCH_DISTANCE]);
+        hits += table.probe(keys[i], entry);
+    }
+    auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    probeSink = hits;  // Keeps the probes from being optimised away
+    return static_cast<double>(elapsedNs) / PROBE_COUNT;
+}
+
+int runBench(int depth, bool counters) {
+    using Clock = std::chrono::steady_clock;
+
+    const int positionCount = sizeof(benchPositions) / sizeof(benchPositions[0]);
+    uint64_t totalNodes = 0;
+    uint64_t tablebaseHits = 0;
+    std::unique_ptr<PerfCounters> perfCounters;
+    if (counters) perfCounters = std::make_unique<PerfCounters>();
+
+    if (perfCounters) perfCounters->start();
+    auto start = Clock::now();
+
+    for (int i = 0; i < positionCount; ++i) {
+        Board board(benchPositions[i]);
+        BasicEngine engine(depth);  // Fresh transposition table per position
+        engine.setHashSize(BENCH_HASH_MEGABYTES);
+        engine.getBestMove(board);
+        totalNodes += engine.getNodeCount();
+        tablebaseHits += engine.getTablebaseHits();
+
+        std::cout << "Position " << (i + 1) << "/" << positionCount << ": "
+                  << engine.getNodeCount() << " nodes" << std::endl;
+    }
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+    if (perfCounters) perfCounters->stop();
+    if (elapsedMs == 0) elapsedMs = 1;
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Total time (ms) : " << elapsedMs << std::endl;
+    std::cout << "Nodes searched  : " << totalNodes << std::endl;
+    std::cout << "Nodes/second    : " << totalNodes * 1000 / elapsedMs << std::endl;
+    std::cout << "Tablebase hits  : " << tablebaseHits << std::endl;
+    if (perfCounters) perfCounters->report(std::cout, totalNodes);
+
+    // Not part of the signature: what huge pages and prefetching save per
+    // probe once the table is too big for the TLB
+    std::cout << "Hash probes (" << PROBE_TABLE_MEGABYTES << " MB, random keys)" << std::endl;
+    double normalNs, hugeNs, prefetchedNs;
+    PageKind hugeKind;
+    {
+        TranspositionTable table(PROBE_TABLE_MEGABYTES, false);
+        normalNs = timeProbes(table, false);
+    }
+    {
+        TranspositionTable table(PROBE_TABLE_MEGABYTES, true);
+        hugeKind = table.pageKind();
+        hugeNs = timeProbes(table, false);
+        table.clear();
+        prefetchedNs = timeProbes(table, true);
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  normal pages  : " << normalNs << " ns" << std::endl;
+    std::cout << "  huge pages    : " << hugeNs << " ns (" << pageKindName(hugeKind) << ")" << std::endl;
+    std::cout << "  + prefetch    : " << prefetchedNs << " ns" << std::endl;
+    return 0;
+}
+
+// Nodes searched and milliseconds taken by threads workers sharing out the
+// bench positions
+static uint64_t searchInParallel(int depth, int threads, NumaPolicy policy, int64_t& elapsedMs) {
+    using Clock = std::chrono::steady_clock;
+
+    const int positionCount = sizeof(benchPositions) / sizeof(benchPositions[0]);
+    std::atomic<int> nextPosition{0};
+    std::atomic<uint64_t> totalNodes{0};
+
+    auto worker = [&](int index) {
+        // Pinned before the engine exists, so its table is on the local node
+        NumaTopology::system().bindThread(index, policy);
+        uint64_t nodes = 0;
+        for (int i = nextPosition++; i < positionCount; i = nextPosition++) {
+            Board board(benchPositions[i]);
+            BasicEngine engine(depth);
+            engine.setHashSize(BENCH_HASH_MEGABYTES);
+            engine.getBestMove(board);
+            nodes += engine.getNodeCount();
+        }
+        totalNodes += nodes;
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) workers.emplace_back(worker, i);
+    for (std::thread& thread : workers) thread.join();
+    elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    if (elapsedMs == 0) elapsedMs = 1;
+    return totalNodes;
+}
+
+int runScalingBench(int depth, int maxThreads, NumaPolicy policy) {
+    maxThreads = std::max(1, maxThreads);
+    std::cout << "NUMA topology   : " << NumaTopology::system().describe() << std::endl;
+    std::cout << "NUMA policy     : " << numaPolicyName(policy)
+              << (NumaTopology::system().binds(policy) ? " (threads pinned)" : " (threads unpinned)") << std::endl;
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << " threads     nodes/second   per thread  speedup" << std::endl;
+    uint64_t singleNps = 0;
+    for (int threads : threadCounts) {
+        int64_t elapsedMs;
+        uint64_t nodes = searchInParallel(depth, threads, policy, elapsedMs);
+        uint64_t nps = nodes * 1000 / elapsedMs;
+        if (threads == 1) singleNps = nps;
+        std::cout << std::setw(8) << threads << std::setw(17) << nps << std::setw(13) << nps / threads
+                  << std::setw(8) << std::fixed << std::setprecision(2)
+                  << static_cast<double>(nps) / std::max<uint64_t>(1, singleNps) << "x" << std::endl;
+    }
+    return 0;
+}
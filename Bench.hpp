@@ -0,0 +1,21 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "Numa.hpp"
+
+// Searches a built-in set of positions to a fixed depth with a fresh
+// BasicEngine each time and prints the total node count and speed. The node
+// count is a signature of search behaviour: any change that alters the search
+// changes it, while pure speed-ups only change the nodes/second figure.
+// With counters set, hardware performance counters over the searches are
+// reported per node as well.
+int runBench(int depth, bool counters = false);
+
+// Searches the bench positions with 1, 2, 4, ... up to maxThreads workers,
+// each worker placed by the NUMA policy and taking positions from a shared
+// counter with its own engine and table, and prints the nodes/second per
+// thread count. Nodes per thread staying flat as threads are added is
+// perfect scaling; the drop shows what memory and placement cost.
+int runScalingBench(int depth, int maxThreads, NumaPolicy policy);
+
+#endif  // BENCH_HPP
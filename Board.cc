@@ -1,20 +1,26 @@
 #include "Board.hpp"
 
+#include "PackedPosition.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
 #include <bitset>
 #include <iostream>
+#include <mutex>
 #include <random>
 
-static const uint64_t FILE_A = 0x0101010101010101ULL;
-static const uint64_t FILE_H = 0x8080808080808080ULL;
+static constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+static constexpr uint64_t FILE_H = 0x8080808080808080ULL;
 
 std::array<std::array<uint64_t, 64>, 12> zobristTable;
 std::array<uint64_t, 4> zobristCastle;
 std::array<uint64_t, 8> zobristEnPassant;
 uint64_t zobristBlackToMove;
 
-void initializeZobristTables() {
-    std::random_device rd;
-    std::mt19937_64 gen(rd());
+static void fillZobristTables() {
+    // Fixed seed so hashes (and therefore search results) are reproducible
+    // between runs
+    std::mt19937_64 gen(0x960C4E55ULL);
     std::uniform_int_distribution<uint64_t> dis;
 
     for (auto& pieceArray : zobristTable) {
@@ -34,50 +40,272 @@ void initializeZobristTables() {
     zobristBlackToMove = dis(gen);
 }
 
-Board::Board(const std::string& epd)
-    : lastMove(-1, -1), enPassantTarget(-1), colorTurn(1), halfMoveClock(0) {
+void initializeZobristTables() {
+    // Boards may be created on several threads at once
+    static std::once_flag initialized;
+    std::call_once(initialized, fillZobristTables);
+}
+
+Board::Board(std::string_view fen) : Position(), fullMoveNumber(1), lastMove(-1, -1) {
+    initializeZobristTables();
+    loadFEN(fen);
+}
+
+// Splits off the next space separated field, leaving the remainder in rest
+static std::string_view nextField(std::string_view& rest) {
+    size_t begin = rest.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+        rest = std::string_view();
+        return rest;
+    }
+    rest.remove_prefix(begin);
+    size_t end = rest.find(' ');
+    std::string_view field = rest.substr(0, end);
+    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end);
+    return field;
+}
+
+static bool parseNumber(std::string_view field, int& value) {
+    if (field.empty() || field.size() > 6) return false;
+    int result = 0;
+    for (char c : field) {
+        if (c < '0' || c > '9') return false;
+        result = result * 10 + (c - '0');
+    }
+    value = result;
+    return true;
+}
+
+static char* writeNumber(char* out, int value) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) *out++ = digits[--count];
+    return out;
+}
+
+void Board::loadFEN(std::string_view fen, bool updateMoves) {
     bitboards.fill(0);
-    whitePieces = 0;
-    blackPieces = 0;
-    allPieces = 0;
-
-    // Parse the EPD string and set the bits in the bitboards
-    int squareIndex = 56;  // Start from rank 8
-    std::istringstream iss(epd);
-    std::string token;
-    canWhiteCastleKingside = true;
-    canWhiteCastleQueenside = true;
-    canBlackCastleKingside = true;
-    canBlackCastleQueenside = true;
-
-    while (std::getline(iss, token, '/')) {
-        for (char c : token) {
-            if (std::isdigit(c)) {
-                squareIndex += c - '0';
+    std::string_view rest = fen;
+
+    // Piece placement, rank 8 first
+    std::string_view placement = nextField(rest);
+    int rank = 7;
+    int file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) {
+                throw std::runtime_error("Invalid rank in FEN");
+            }
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) {
+                throw std::runtime_error("Invalid rank in FEN");
+            }
+        } else {
+            int pieceIndex = charToPieceIndex(c);
+            if (pieceIndex == -1 || file > 7) {
+                throw std::runtime_error("Invalid piece character in EPD");
+            }
+            bitboards[pieceIndex] |= 1ULL << (rank * 8 + file);
+            ++file;
+        }
+    }
+    if (rank != 0 || file != 8) {
+        throw std::runtime_error("Incomplete piece placement in FEN");
+    }
+    if (!hasOneKingEach()) {
+        throw std::runtime_error("FEN needs exactly one king of each color");
+    }
+    updateAggregateBitboards();
+
+    // Side to move
+    std::string_view side = nextField(rest);
+    if (side.empty() || side == "w") {
+        colorTurn = 1;
+    } else if (side == "b") {
+        colorTurn = -1;
+    } else {
+        throw std::runtime_error("Invalid side to move in FEN");
+    }
+
+    // Castling rights; a bare placement gets every right its rooks allow
+    std::string_view castling = nextField(rest);
+    parseCastling(castling.empty() ? std::string_view("KQkq") : castling);
+
+    // En passant target
+    std::string_view enPassant = nextField(rest);
+    enPassantTarget = -1;
+    if (!enPassant.empty() && enPassant != "-") {
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' ||
+            (enPassant[1] != '3' && enPassant[1] != '6')) {
+            throw std::runtime_error("Invalid en passant square in FEN");
+        }
+        enPassantTarget = static_cast<int8_t>((enPassant[1] - '1') * 8 + (enPassant[0] - 'a'));
+    }
+
+    // Move clocks. EPD has operations here instead, which are ignored.
+    halfMoveClock = 0;
+    fullMoveNumber = 1;
+    int clock;
+    if (parseNumber(nextField(rest), clock)) {
+        halfMoveClock = static_cast<uint16_t>(std::min(clock, 65535));
+        int moveNumber;
+        if (parseNumber(nextField(rest), moveNumber) && moveNumber > 0) {
+            fullMoveNumber = moveNumber;
+        }
+    }
+
+    hash = computeHashFromScratch();
+    resetHistory(updateMoves);
+}
+
+void Board::resetHistory(bool updateMoves) {
+    lastMove = Move(-1, -1);
+    positionHistory.clear();
+    moves.clear();
+    status = GameStatus::Ongoing;
+    if (updateMoves) {
+        positionHistory.push_back(computeHash());
+        generateMoves();
+        updateStatus(true);
+    }
+}
+
+bool Board::hasOneKingEach() const {
+    return __builtin_popcountll(bitboards[PieceType::WhiteKing]) == 1 &&
+           __builtin_popcountll(bitboards[PieceType::BlackKing]) == 1;
+}
+
+void Board::parseCastling(std::string_view field) {
+    castlingRooks.fill(-1);
+    if (field == "-") return;
+
+    for (char c : field) {
+        int color = (c >= 'A' && c <= 'Z') ? 1 : -1;
+        char upper = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+        // Checked before the king: a bad character is an error wherever the king is
+        if (upper != 'K' && upper != 'Q' && (upper < 'A' || upper > 'H')) {
+            throw std::runtime_error("Invalid castling field in FEN");
+        }
+        int backRank = (color == 1) ? 0 : 56;
+        uint64_t rankMask = 0xFFULL << backRank;
+        uint64_t kings = bitboards[color == 1 ? PieceType::WhiteKing : PieceType::BlackKing] & rankMask;
+        uint64_t rooks = bitboards[color == 1 ? PieceType::WhiteRook : PieceType::BlackRook] & rankMask;
+        if (!kings) continue;  // King has left the back rank, no castling possible
+        int kingSquare = __builtin_ctzll(kings);
+
+        int rookSquare = -1;
+        if (upper == 'K') {
+            // Outermost rook on the kingside (X-FEN)
+            uint64_t candidates = rooks & ~((2ULL << kingSquare) - 1);
+            if (candidates) rookSquare = 63 - __builtin_clzll(candidates);
+        } else if (upper == 'Q') {
+            uint64_t candidates = rooks & ((1ULL << kingSquare) - 1);
+            if (candidates) rookSquare = __builtin_ctzll(candidates);
+        } else {
+            // Rook file (Shredder-FEN, or X-FEN for an inner rook)
+            int square = backRank + (upper - 'A');
+            if (rooks & (1ULL << square)) rookSquare = square;
+        }
+        if (rookSquare == -1 || rookSquare == kingSquare) continue;
+
+        int right = (color == 1 ? CastlingRight::WhiteKingside : CastlingRight::BlackKingside) +
+                    (rookSquare > kingSquare ? 0 : 1);
+        castlingRooks[right] = static_cast<int8_t>(rookSquare);
+    }
+}
+
+size_t Board::writePlacement(char* buffer) const {
+    char squares[64] = {};
+    for (int i = 0; i < 12; ++i) {
+        uint64_t pieces = bitboards[i];
+        while (pieces) {
+            int square = __builtin_ctzll(pieces);
+            pieces &= pieces - 1;
+            squares[square] = pieceIndexToChar(i);
+        }
+    }
+
+    char* out = buffer;
+    for (int rank = 7; rank >= 0; --rank) {
+        int emptyCount = 0;
+        for (int file = 0; file < 8; ++file) {
+            char c = squares[rank * 8 + file];
+            if (c == 0) {
+                emptyCount++;
             } else {
-                int pieceIndex = charToPieceIndex(c);
-                if (pieceIndex != -1 && squareIndex >= 0 && squareIndex < 64) {
-                    uint64_t bit = 1ULL << squareIndex;  // Bitboard mapping
-                    bitboards[pieceIndex] |= bit;
-                    if (pieceIndex < 6) {
-                        whitePieces |= bit;
-                    } else {
-                        blackPieces |= bit;
-                    }
-                    allPieces |= bit;
-                    squareIndex++;
-                } else {
-                    throw std::runtime_error("Invalid piece character in EPD");
+                if (emptyCount > 0) {
+                    *out++ = static_cast<char>('0' + emptyCount);
+                    emptyCount = 0;
                 }
+                *out++ = c;
             }
         }
-        squareIndex -= 16;  // Move to the next rank
+        if (emptyCount > 0) *out++ = static_cast<char>('0' + emptyCount);
+        if (rank > 0) *out++ = '/';
     }
+    return out - buffer;
+}
 
-    positionHistory.push_back(boardToEPD());
-    generateMoves();
+size_t Board::writeEPD(char* buffer, bool shredder) const {
+    char* out = buffer + writePlacement(buffer);
 
-    initializeZobristTables();
+    *out++ = ' ';
+    *out++ = (colorTurn == 1) ? 'w' : 'b';
+
+    *out++ = ' ';
+    char* castlingStart = out;
+    for (int right = 0; right < 4; ++right) {
+        int rookSquare = castlingRooks[right];
+        if (rookSquare == -1) continue;
+
+        bool white = right < CastlingRight::BlackKingside;
+        bool kingside = (right % 2) == 0;
+        uint64_t backRankRooks = bitboards[white ? PieceType::WhiteRook : PieceType::BlackRook] &
+                                 (0xFFULL << (rookSquare & 56));
+        uint64_t beyond = kingside ? backRankRooks & ~((2ULL << rookSquare) - 1)
+                                   : backRankRooks & ((1ULL << rookSquare) - 1);
+
+        char c;
+        if (!shredder && !beyond) {
+            c = kingside ? 'K' : 'Q';
+        } else {
+            c = static_cast<char>('A' + rookSquare % 8);
+        }
+        *out++ = white ? c : static_cast<char>(c - 'A' + 'a');
+    }
+    if (out == castlingStart) *out++ = '-';
+
+    *out++ = ' ';
+    if (enPassantTarget == -1) {
+        *out++ = '-';
+    } else {
+        *out++ = static_cast<char>('a' + enPassantTarget % 8);
+        *out++ = static_cast<char>('1' + enPassantTarget / 8);
+    }
+    return out - buffer;
+}
+
+size_t Board::writeFEN(char* buffer, bool shredder) const {
+    char* out = buffer + writeEPD(buffer, shredder);
+    *out++ = ' ';
+    out = writeNumber(out, halfMoveClock);
+    *out++ = ' ';
+    out = writeNumber(out, fullMoveNumber);
+    *out = '\0';
+    return out - buffer;
+}
+
+std::string Board::toFEN(bool shredder) const {
+    char buffer[FEN_BUFFER_SIZE];
+    size_t length = writeFEN(buffer, shredder);
+    return std::string(buffer, length);
 }
 
 int Board::charToPieceIndex(char c) const {
@@ -152,35 +380,109 @@ int Board::getPieceAt(int square) const {
     return -1;  // Empty square
 }
 
-std::string Board::boardToEPD() const {
-    std::ostringstream epd;
-    int emptyCount = 0;
+PackedPosition Board::pack() const {
+    PackedPosition packed = {};
+    if (__builtin_popcountll(occupied()) > 32) {
+        throw std::runtime_error("Too many pieces to pack");
+    }
 
-    for (int rank = 7; rank >= 0; --rank) {
-        for (int file = 0; file < 8; ++file) {
-            int squareIndex = rank * 8 + file;
-            int pieceIndex = getPieceAt(squareIndex);
-            if (pieceIndex == -1) {
-                emptyCount++;
-            } else {
-                if (emptyCount > 0) {
-                    epd << emptyCount;
-                    emptyCount = 0;
-                }
-                epd << pieceIndexToChar(pieceIndex);
+    packed.occupancy = occupied();
+    int index = 0;
+    uint64_t remaining = occupied();
+    while (remaining) {
+        int square = __builtin_ctzll(remaining);
+        remaining &= remaining - 1;
+
+        int code = getPieceAt(square);
+        for (int right = 0; right < 4; ++right) {
+            if (castlingRooks[right] == square) {
+                code = (right < CastlingRight::BlackKingside) ? PackedPosition::CastlingRookWhite
+                                                              : PackedPosition::CastlingRookBlack;
             }
         }
-        if (emptyCount > 0) {
-            epd << emptyCount;
-            emptyCount = 0;
+        packed.pieces[index / 2] |= static_cast<uint8_t>(code << ((index % 2) * 4));
+        ++index;
+    }
+
+    packed.sideToMove = (colorTurn == 1) ? 0 : 1;
+    packed.enPassant = (enPassantTarget == -1) ? PackedPosition::NoEnPassant
+                                               : static_cast<uint8_t>(enPassantTarget);
+    packed.halfMoveClock = static_cast<uint8_t>(std::min<int>(halfMoveClock, 255));
+    packed.fullMoveNumber = static_cast<uint16_t>(std::min(fullMoveNumber, 65535));
+    return packed;
+}
+
+void Board::loadPacked(const PackedPosition& packed, bool updateMoves) {
+    // One nibble per piece: a corrupt record with more pieces than nibbles
+    // would read past the end of pieces
+    if (__builtin_popcountll(packed.occupancy) > 2 * static_cast<int>(sizeof(packed.pieces))) {
+        throw std::runtime_error("Too many pieces in packed position");
+    }
+
+    bitboards.fill(0);
+    castlingRooks.fill(-1);
+
+    uint64_t castlingRookSquares = 0;
+    int index = 0;
+    uint64_t occupied = packed.occupancy;
+    while (occupied) {
+        int square = __builtin_ctzll(occupied);
+        occupied &= occupied - 1;
+
+        int code = (packed.pieces[index / 2] >> ((index % 2) * 4)) & 0xF;
+        ++index;
+        if (code == PackedPosition::CastlingRookWhite) {
+            code = PieceType::WhiteRook;
+            castlingRookSquares |= 1ULL << square;
+        } else if (code == PackedPosition::CastlingRookBlack) {
+            code = PieceType::BlackRook;
+            castlingRookSquares |= 1ULL << square;
+        } else if (code > PieceType::BlackPawn) {
+            throw std::runtime_error("Invalid piece code in packed position");
         }
-        if (rank > 0) epd << '/';
+        bitboards[code] |= 1ULL << square;
+    }
+    if (!hasOneKingEach()) {
+        throw std::runtime_error("Packed position needs exactly one king of each color");
+    }
+    updateAggregateBitboards();
+
+    // Castling side follows from which side of its king the rook stands
+    while (castlingRookSquares) {
+        int rookSquare = __builtin_ctzll(castlingRookSquares);
+        castlingRookSquares &= castlingRookSquares - 1;
+
+        bool white = (bitboards[PieceType::WhiteRook] >> rookSquare) & 1;
+        uint64_t kings = bitboards[white ? PieceType::WhiteKing : PieceType::BlackKing] &
+                         (0xFFULL << (rookSquare & 56));
+        if (!kings) continue;
+        int kingSquare = __builtin_ctzll(kings);
+        int right = (white ? CastlingRight::WhiteKingside : CastlingRight::BlackKingside) +
+                    (rookSquare > kingSquare ? 0 : 1);
+        castlingRooks[right] = static_cast<int8_t>(rookSquare);
     }
 
-    return epd.str();
+    colorTurn = (packed.sideToMove == 0) ? 1 : -1;
+    enPassantTarget = (packed.enPassant < 64) ? static_cast<int8_t>(packed.enPassant) : -1;
+    halfMoveClock = packed.halfMoveClock;
+    fullMoveNumber = std::max<int>(packed.fullMoveNumber, 1);
+
+    hash = computeHashFromScratch();
+    resetHistory(updateMoves);
+}
+
+std::string Board::boardToEPD() const {
+    char buffer[FEN_BUFFER_SIZE];
+    size_t length = writeEPD(buffer, false);
+    return std::string(buffer, length);
 }
 
 void Board::makeMove(const Move& move, bool updateMoves) {
+    applyMove(move, keyAfter(move), updateMoves);
+}
+
+void Board::applyMove(const Move& move, uint64_t key, bool updateMoves) {
+    TRACE_ZONE("Board::makeMove");
     int pieceIndex = getPieceAt(move.startSquare);
     if (pieceIndex == -1) {
         throw std::runtime_error("No piece on start square");
@@ -188,34 +490,46 @@ void Board::makeMove(const Move& move, bool updateMoves) {
 
     uint64_t fromBit = 1ULL << move.startSquare;
     uint64_t toBit = 1ULL << move.targetSquare;
+    hash = key;
+
+    // Pawn moves and captures reset the fifty-move counter
+    bool resetsClock = (pieceIndex % 6) == BasePieceType::Pawn ||
+                       (!move.isCastling && (occupied() & toBit));
+
+    if (move.isCastling) {
+        // The king "captures" its own rook; both land on their fixed files
+        int rookPieceIndex = pieceIndex + (BasePieceType::Rook - BasePieceType::King);
+        int kingTarget = castlingKingTarget(move);
+        int rookTarget = kingTarget + ((move.targetSquare > move.startSquare) ? -1 : 1);
+        bitboards[pieceIndex] &= ~fromBit;
+        bitboards[rookPieceIndex] &= ~toBit;
+        bitboards[pieceIndex] |= 1ULL << kingTarget;
+        bitboards[rookPieceIndex] |= 1ULL << rookTarget;
+    } else {
+        // Remove piece from start square
+        bitboards[pieceIndex] &= ~fromBit;
+
+        // Handle capture
+        for (int i = 0; i < 12; ++i) {
+            if (i != pieceIndex && (bitboards[i] & toBit)) {
+                // Capture
+                bitboards[i] &= ~toBit;
+                break;
+            }
+        }
 
-    // Remove piece from start square
-    bitboards[pieceIndex] &= ~fromBit;
-
-    // Handle capture
-    for (int i = 0; i < 12; ++i) {
-        if (i != pieceIndex && (bitboards[i] & toBit)) {
-            // Capture
-            bitboards[i] &= ~toBit;
-            break;
+        // Handle en passant capture
+        if (move.isEnPassant) {
+            int capturedPawnSquare =
+                move.targetSquare + ((colorTurn == 1) ? -8 : 8);
+            uint64_t capturedPawnBit = 1ULL << capturedPawnSquare;
+            int capturedPawnIndex = (colorTurn == 1) ? PieceType::BlackPawn
+                                                     : PieceType::WhitePawn;
+            bitboards[capturedPawnIndex] &= ~capturedPawnBit;
         }
-    }
 
-    // Handle en passant capture
-    if (move.isEnPassant) {
-        int capturedPawnSquare =
-            move.targetSquare + ((colorTurn == 1) ? -8 : 8);
-        uint64_t capturedPawnBit = 1ULL << capturedPawnSquare;
-        int capturedPawnIndex = (colorTurn == 1) ? PieceType::BlackPawn
-                                                 : PieceType::WhitePawn;
-        bitboards[capturedPawnIndex] &= ~capturedPawnBit;
-    }
-
-    // Promotion
-    if (move.promotionPiece != 0) {
-        bitboards[move.promotionPiece] |= toBit;
-    } else {
-        bitboards[pieceIndex] |= toBit;
+        // Promotion
+        bitboards[(move.promotionPiece != 0) ? move.promotionPiece : pieceIndex] |= toBit;
     }
 
     updateAggregateBitboards();
@@ -224,69 +538,106 @@ void Board::makeMove(const Move& move, bool updateMoves) {
     if ((pieceIndex == PieceType::WhitePawn ||
          pieceIndex == PieceType::BlackPawn) &&
         std::abs(move.startSquare - move.targetSquare) == 16) {
-        enPassantTarget = (move.startSquare + move.targetSquare) / 2;
+        enPassantTarget = static_cast<int8_t>((move.startSquare + move.targetSquare) / 2);
     } else {
         enPassantTarget = -1;
     }
 
+    if (colorTurn == -1) {
+        fullMoveNumber++;
+    }
     colorTurn = -colorTurn;
     if (updateMoves) {
         lastMove = move;
     }
 
-    // Castling
-    if (pieceIndex == PieceType::WhiteKing || pieceIndex == PieceType::BlackKing) {
-        if (std::abs(move.startSquare - move.targetSquare) == 2) {
-            int rookStartSquare, rookTargetSquare;
-            if (move.targetSquare > move.startSquare) {
-                // Kingside castling
-                rookStartSquare = move.startSquare + 3;
-                rookTargetSquare = move.startSquare + 1;
-            } else {
-                // Queenside castling
-                rookStartSquare = move.startSquare - 4;
-                rookTargetSquare = move.startSquare - 1;
-            }
-            int rookPieceIndex = getPieceAt(rookStartSquare);
-            bitboards[rookPieceIndex] &= ~(1ULL << rookStartSquare);
-            bitboards[rookPieceIndex] |= (1ULL << rookTargetSquare);
-        }
-    }
-
-    // Update castling rights
-    if (pieceIndex == PieceType::WhiteKing) {
-        canWhiteCastleKingside = false;
-        canWhiteCastleQueenside = false;
-    } else if (pieceIndex == PieceType::BlackKing) {
-        canBlackCastleKingside = false;
-        canBlackCastleQueenside = false;
-    } else if (pieceIndex == PieceType::WhiteRook) {
-        if (move.startSquare == 0) canWhiteCastleQueenside = false;
-        if (move.startSquare == 7) canWhiteCastleKingside = false;
-    } else if (pieceIndex == PieceType::BlackRook) {
-        if (move.startSquare == 56) canBlackCastleQueenside = false;
-        if (move.startSquare == 63) canBlackCastleKingside = false;
+    // Update castling rights: a king move loses both, and moving or capturing
+    // a castling rook loses that side
+    for (int right = 0; right < 4; ++right) {
+        if (losesCastlingRight(right, pieceIndex, move)) castlingRooks[right] = -1;
     }
 
     // Update halfMoveClock
-    if (getPieceAt(move.targetSquare) != -1 || charToPieceIndex('P') == (getPieceAt(move.startSquare) % 6)) {
+    if (resetsClock) {
         halfMoveClock = 0;
-    } else {
+    } else if (halfMoveClock < UINT16_MAX) {
         halfMoveClock++;
     }
 
-    // Update position history
-    positionHistory.push_back(boardToEPD());
-
+    // Update position history; trial moves made by isMoveLegal are undone
+    // straight away and never need it
     if (updateMoves) {
+        positionHistory.push_back(computeHash());
         generateMoves();
+        updateStatus(true);
+    }
+}
+
+bool Board::losesCastlingRight(int right, int pieceIndex, const Move& move) const {
+    int rookSquare = castlingRooks[right];
+    if (rookSquare == -1) return false;
+    int king = (right < CastlingRight::BlackKingside) ? PieceType::WhiteKing : PieceType::BlackKing;
+    return pieceIndex == king || rookSquare == move.startSquare || rookSquare == move.targetSquare;
+}
+
+uint64_t Board::keyAfter(const Move& move) const {
+    int pieceIndex = getPieceAt(move.startSquare);
+    uint64_t key = hash ^ zobristBlackToMove;
+
+    if (move.isCastling) {
+        int rookPieceIndex = pieceIndex + (BasePieceType::Rook - BasePieceType::King);
+        int kingTarget = castlingKingTarget(move);
+        int rookTarget = kingTarget + ((move.targetSquare > move.startSquare) ? -1 : 1);
+        key ^= zobristTable[pieceIndex][move.startSquare] ^ zobristTable[pieceIndex][kingTarget] ^
+               zobristTable[rookPieceIndex][move.targetSquare] ^ zobristTable[rookPieceIndex][rookTarget];
+    } else {
+        key ^= zobristTable[pieceIndex][move.startSquare];
+        if (move.isEnPassant) {
+            int capturedPawnIndex = (colorTurn == 1) ? PieceType::BlackPawn : PieceType::WhitePawn;
+            key ^= zobristTable[capturedPawnIndex][move.targetSquare - 8 * colorTurn];
+        } else {
+            int captured = getPieceAt(move.targetSquare);
+            if (captured != -1) key ^= zobristTable[captured][move.targetSquare];
+        }
+        key ^= zobristTable[(move.promotionPiece != 0) ? move.promotionPiece : pieceIndex][move.targetSquare];
+    }
+
+    if (enPassantTarget != -1) key ^= zobristEnPassant[enPassantTarget % 8];
+    if ((pieceIndex % 6) == BasePieceType::Pawn && std::abs(move.startSquare - move.targetSquare) == 16) {
+        key ^= zobristEnPassant[move.startSquare % 8];
+    }
+
+    for (int right = 0; right < 4; ++right) {
+        if (losesCastlingRight(right, pieceIndex, move)) key ^= zobristCastle[right];
     }
+    return key;
+}
+
+SearchUndo Board::makeSearchMove(const Move& move) {
+    return makeSearchMove(move, keyAfter(move));
+}
+
+SearchUndo Board::makeSearchMove(const Move& move, uint64_t key) {
+    SearchUndo undo{*this, lastMove, fullMoveNumber, status};
+    applyMove(move, key, false);
+    lastMove = move;
+    positionHistory.push_back(hash);
+    moves.clear();
+    updateStatus(false);
+    return undo;
+}
+
+void Board::undoSearchMove(const SearchUndo& undo) {
+    static_cast<Position&>(*this) = undo.position;
+    lastMove = undo.lastMove;
+    fullMoveNumber = undo.fullMoveNumber;
+    status = undo.status;
+    positionHistory.pop_back();
 }
 
 void Board::updateAggregateBitboards() {
     whitePieces = 0;
     blackPieces = 0;
-    allPieces = 0;
 
     for (int i = 0; i < 6; ++i) {
         whitePieces |= bitboards[i];
@@ -294,7 +645,6 @@ void Board::updateAggregateBitboards() {
     for (int i = 6; i < 12; ++i) {
         blackPieces |= bitboards[i];
     }
-    allPieces = whitePieces | blackPieces;
 }
 
 bool Board::isLastMoveTile(int tileIndex) const {
@@ -302,544 +652,608 @@ bool Board::isLastMoveTile(int tileIndex) const {
            tileIndex == lastMove.targetSquare;
 }
 
-void Board::generateMoves() {
-    moves.clear();
-
-    if (colorTurn == 1) {
-        generatePawnMoves(PieceType::WhitePawn);
-        generateKnightMoves(PieceType::WhiteKnight);
-        generateBishopMoves(PieceType::WhiteBishop);
-        generateRookMoves(PieceType::WhiteRook);
-        generateQueenMoves(PieceType::WhiteQueen);
-        generateKingMoves(PieceType::WhiteKing);
-    } else {
-        generatePawnMoves(PieceType::BlackPawn);
-        generateKnightMoves(PieceType::BlackKnight);
-        generateBishopMoves(PieceType::BlackBishop);
-        generateRookMoves(PieceType::BlackRook);
-        generateQueenMoves(PieceType::BlackQueen);
-        generateKingMoves(PieceType::BlackKing);
-    }
-
-    std::vector<Move> legalMoves;
-    for (const Move& move : moves) {
-        if (isMoveLegal(move)) {
-            legalMoves.push_back(move);
-        }
-    }
-    moves = std::move(legalMoves);
+int Board::castlingKingTarget(const Move& move) {
+    int backRank = move.startSquare & 56;
+    return backRank + ((move.targetSquare > move.startSquare) ? 6 : 2);
 }
 
+// Attack tables, built at compile time. Rays run from a square (exclusive) to
+// the board edge; the first four directions increase the square index.
+namespace {
 
+enum Direction { North, East, NorthEast, NorthWest, South, West, SouthWest, SouthEast };
 
-// Knight move generation
-void Board::generateKnightMoves(int knightPieceIndex) {
-    uint64_t knights = bitboards[knightPieceIndex];
-    uint64_t ownPieces = (colorTurn == 1) ? whitePieces : blackPieces;
+constexpr int DIRECTION_FILE_STEP[8] = {0, 1, 1, -1, 0, -1, -1, 1};
+constexpr int DIRECTION_RANK_STEP[8] = {1, 0, 1, 1, -1, 0, -1, -1};
 
-    while (knights) {
-        int square = __builtin_ctzll(knights);  // Get least significant bit index
-        uint64_t knightBit = 1ULL << square;
-        knights &= ~knightBit;  // Remove this knight from knights
-
-        uint64_t attacks = knightAttackBitboard(square) & ~ownPieces;  // Exclude own pieces
-
-        while (attacks) {
-            int targetSquare = __builtin_ctzll(attacks);
-            uint64_t targetBit = 1ULL << targetSquare;
-            attacks &= ~targetBit;
-
-            moves.emplace_back(square, targetSquare);
+constexpr std::array<uint64_t, 64> leaperAttacks(const int (&fileSteps)[8], const int (&rankSteps)[8]) {
+    std::array<uint64_t, 64> table{};
+    for (int square = 0; square < 64; ++square) {
+        for (int i = 0; i < 8; ++i) {
+            int file = square % 8 + fileSteps[i];
+            int rank = square / 8 + rankSteps[i];
+            if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                table[square] |= 1ULL << (rank * 8 + file);
+            }
         }
     }
+    return table;
 }
 
-uint64_t Board::knightAttackBitboard(int square) const {
-    static const int knightOffsets[8] = {17, 15, 10, 6, -6, -10, -15, -17};
-    uint64_t attacks = 0ULL;
-    int file = square % 8;
-    int rank = square / 8;
-
-    for (int offset : knightOffsets) {
-        int targetSquare = square + offset;
-        int targetFile = targetSquare % 8;
-        int targetRank = targetSquare / 8;
-
-        if (targetSquare >= 0 && targetSquare < 64 &&
-            std::abs(file - targetFile) <= 2 && std::abs(rank - targetRank) <= 2 &&
-            ((std::abs(file - targetFile) == 1 && std::abs(rank - targetRank) == 2) ||
-             (std::abs(file - targetFile) == 2 && std::abs(rank - targetRank) == 1))) {
-            attacks |= 1ULL << targetSquare;
+constexpr int KNIGHT_FILE_STEPS[8] = {1, 2, 2, 1, -1, -2, -2, -1};
+constexpr int KNIGHT_RANK_STEPS[8] = {2, 1, -1, -2, -2, -1, 1, 2};
+
+constexpr std::array<uint64_t, 64> KNIGHT_ATTACKS = leaperAttacks(KNIGHT_FILE_STEPS, KNIGHT_RANK_STEPS);
+constexpr std::array<uint64_t, 64> KING_ATTACKS = leaperAttacks(DIRECTION_FILE_STEP, DIRECTION_RANK_STEP);
+
+constexpr std::array<std::array<uint64_t, 64>, 8> buildRays() {
+    std::array<std::array<uint64_t, 64>, 8> rays{};
+    for (int direction = 0; direction < 8; ++direction) {
+        for (int square = 0; square < 64; ++square) {
+            int file = square % 8 + DIRECTION_FILE_STEP[direction];
+            int rank = square / 8 + DIRECTION_RANK_STEP[direction];
+            while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                rays[direction][square] |= 1ULL << (rank * 8 + file);
+                file += DIRECTION_FILE_STEP[direction];
+                rank += DIRECTION_RANK_STEP[direction];
+            }
         }
     }
-    return attacks;
+    return rays;
 }
 
-// King move generation
-void Board::generateKingMoves(int kingPieceIndex) {
-    uint64_t kings = bitboards[kingPieceIndex];
-    uint64_t ownPieces = (colorTurn == 1) ? whitePieces : blackPieces;
-
-    while (kings) {
-        int square = __builtin_ctzll(kings);
-        uint64_t kingBit = 1ULL << square;
-        kings &= ~kingBit;
-
-        uint64_t attacks = kingAttackBitboard(square) & ~ownPieces;
+constexpr std::array<std::array<uint64_t, 64>, 8> RAYS = buildRays();
 
-        while (attacks) {
-            int targetSquare = __builtin_ctzll(attacks);
-            uint64_t targetBit = 1ULL << targetSquare;
-            attacks &= ~targetBit;
-
-            moves.emplace_back(square, targetSquare);
-        }
-
-        // Generate castling moves
-        if (colorTurn == 1) {
-            if (canWhiteCastleKingside && 
-                !(allPieces & ((1ULL << 5) | (1ULL << 6)))) {
-                moves.emplace_back(4, 6, false, 0, true);
-            }
-            if (canWhiteCastleQueenside &&
-                !(allPieces & ((1ULL << 3) | (1ULL << 2) | (1ULL << 1)))) {
-                moves.emplace_back(4, 2, false, 0, true);
-            }
-        } else {
-            if (canBlackCastleKingside && 
-                !(allPieces & ((1ULL << 61) | (1ULL << 62)))) {
-                moves.emplace_back(60, 62, false, 0, true);
-            }
-            if (canBlackCastleQueenside && 
-                !(allPieces & ((1ULL << 59) | (1ULL << 58) | (1ULL << 57)))) {
-                moves.emplace_back(60, 58, false, 0, true);
-            }
-        }
+// Squares a pawn of the given colour attacks, 0 for white and 1 for black
+constexpr std::array<std::array<uint64_t, 64>, 2> buildPawnAttacks() {
+    std::array<std::array<uint64_t, 64>, 2> table{};
+    for (int square = 0; square < 64; ++square) {
+        uint64_t bit = 1ULL << square;
+        table[0][square] = ((bit & ~FILE_A) << 7) | ((bit & ~FILE_H) << 9);
+        table[1][square] = ((bit & ~FILE_A) >> 9) | ((bit & ~FILE_H) >> 7);
     }
+    return table;
 }
-uint64_t Board::kingAttackBitboard(int square) const {
-    static const int kingOffsets[8] = {8, 1, -1, -8, 9, 7, -7, -9};
-    uint64_t attacks = 0ULL;
-    int file = square % 8;
-    int rank = square / 8;
 
-    for (int offset : kingOffsets) {
-        int targetSquare = square + offset;
-        int targetFile = targetSquare % 8;
-        int targetRank = targetSquare / 8;
+constexpr std::array<std::array<uint64_t, 64>, 2> PAWN_ATTACKS = buildPawnAttacks();
 
-        if (targetSquare >= 0 && targetSquare < 64 &&
-            std::abs(file - targetFile) <= 1 && std::abs(rank - targetRank) <= 1) {
-            attacks |= 1ULL << targetSquare;
-        }
+constexpr uint64_t RANK_1 = 0xFFULL;
+constexpr uint64_t RANK_3 = RANK_1 << 16;
+constexpr uint64_t RANK_6 = RANK_1 << 40;
+constexpr uint64_t RANK_8 = RANK_1 << 56;
+
+template <Direction D>
+inline uint64_t rayAttacks(int square, uint64_t occupancy) {
+    uint64_t attacks = RAYS[D][square];
+    uint64_t blockers = attacks & occupancy;
+    if (blockers) {
+        int blocker = (D < South) ? __builtin_ctzll(blockers) : 63 - __builtin_clzll(blockers);
+        attacks ^= RAYS[D][blocker];
     }
     return attacks;
 }
 
-// Bishop move generation
-void Board::generateBishopMoves(int bishopPieceIndex) {
-    uint64_t bishops = bitboards[bishopPieceIndex];
-    uint64_t ownPieces = (colorTurn == 1) ? whitePieces : blackPieces;
-    uint64_t opponentPieces = (colorTurn == 1) ? blackPieces : whitePieces;
+inline uint64_t bishopAttacks(int square, uint64_t occupancy) {
+    return rayAttacks<NorthEast>(square, occupancy) | rayAttacks<NorthWest>(square, occupancy) |
+           rayAttacks<SouthWest>(square, occupancy) | rayAttacks<SouthEast>(square, occupancy);
+}
 
-    static const int bishopOffsets[4] = {9, 7, -7, -9};
+inline uint64_t rookAttacks(int square, uint64_t occupancy) {
+    return rayAttacks<North>(square, occupancy) | rayAttacks<East>(square, occupancy) |
+           rayAttacks<South>(square, occupancy) | rayAttacks<West>(square, occupancy);
+}
 
-    while (bishops) {
-        int square = __builtin_ctzll(bishops);  // Get least significant bit index
-        uint64_t bishopBit = 1ULL << square;
-        bishops &= ~bishopBit;  // Remove this bishop from bishops
+template <int BaseType>
+inline uint64_t pieceAttacks(int square, uint64_t occupancy) {
+    switch (BaseType) {
+        case BasePieceType::Knight: return KNIGHT_ATTACKS[square];
+        case BasePieceType::Bishop: return bishopAttacks(square, occupancy);
+        case BasePieceType::Rook: return rookAttacks(square, occupancy);
+        case BasePieceType::Queen: return bishopAttacks(square, occupancy) | rookAttacks(square, occupancy);
+        default: return KING_ATTACKS[square];
+    }
+}
 
-        for (int offset : bishopOffsets) {
-            int targetSquare = square;
-            while (true) {
-                int fromFile = targetSquare % 8;
-                int fromRank = targetSquare / 8;
+// Squares strictly between two squares on a line, or 0 if they share none
+inline uint64_t squaresBetween(int from, int to) {
+    for (const auto& ray : RAYS) {
+        if (ray[from] & (1ULL << to)) {
+            return ray[from] & ~ray[to] & ~(1ULL << to);
+        }
+    }
+    return 0;
+}
 
-                targetSquare += offset;
-                int toFile = targetSquare % 8;
-                int toRank = targetSquare / 8;
+// Moves the whole set one step towards the given square offset
+template <int Offset>
+constexpr uint64_t shift(uint64_t bits) {
+    return (Offset > 0) ? bits << Offset : bits >> -Offset;
+}
 
-                if (targetSquare < 0 || targetSquare >= 64 ||
-                    std::abs(fromFile - toFile) != 1 || std::abs(fromRank - toRank) != 1)
-                    break;
+constexpr int pieceIndex(int color, int baseType) {
+    return baseType + (color == 1 ? 0 : 6);
+}
 
-                uint64_t targetBit = 1ULL << targetSquare;
+}  // namespace
 
-                if (ownPieces & targetBit) {
-                    break;  // Blocked by own piece
-                }
+void Board::generateMoves() {
+    TRACE_ZONE("Board::generateMoves");
+    generateLegalMoves(isKingInCheck(colorTurn) ? GenerateEvasions : GenerateAll, moves);
+}
 
-                moves.emplace_back(square, targetSquare);
+void Board::generateLegalMoves(MoveGenType type, std::vector<Move>& out) {
+    out.clear();
 
-                if (opponentPieces & targetBit) {
-                    break;  // Capture and stop
-                }
-            }
+    // The only colour test: everything below is instantiated per side
+    if (colorTurn == 1) {
+        switch (type) {
+            case GenerateAll: generate<1, GenerateAll>(out); break;
+            case GenerateCaptures: generate<1, GenerateCaptures>(out); break;
+            case GenerateQuiets: generate<1, GenerateQuiets>(out); break;
+            case GenerateEvasions: generate<1, GenerateEvasions>(out); break;
+        }
+    } else {
+        switch (type) {
+            case GenerateAll: generate<-1, GenerateAll>(out); break;
+            case GenerateCaptures: generate<-1, GenerateCaptures>(out); break;
+            case GenerateQuiets: generate<-1, GenerateQuiets>(out); break;
+            case GenerateEvasions: generate<-1, GenerateEvasions>(out); break;
         }
     }
-}
-
-// Rook move generation
-void Board::generateRookMoves(int rookPieceIndex) {
-    uint64_t rooks = bitboards[rookPieceIndex];
-    uint64_t ownPieces = (colorTurn == 1) ? whitePieces : blackPieces;
-    uint64_t opponentPieces = (colorTurn == 1) ? blackPieces : whitePieces;
-
-    static const int rookOffsets[4] = {8, -8, 1, -1};
-
-    while (rooks) {
-        int square = __builtin_ctzll(rooks);  // Get least significant bit index
-        uint64_t rookBit = 1ULL << square;
-        rooks &= ~rookBit;  // Remove this rook from rooks
 
-        for (int offset : rookOffsets) {
-            int targetSquare = square;
-            while (true) {
-                int fromFile = targetSquare % 8;
-                int fromRank = targetSquare / 8;
-
-                targetSquare += offset;
-                int toFile = targetSquare % 8;
-                int toRank = targetSquare / 8;
+    out.erase(std::remove_if(out.begin(), out.end(), [this](const Move& move) { return !isMoveLegal(move); }),
+              out.end());
+}
 
-                if (targetSquare < 0 || targetSquare >= 64 ||
-                    (offset == 1 || offset == -1) && (fromRank != toRank))
-                    break;
+void Board::generateQuietChecks(std::vector<Move>& out) {
+    generateLegalMoves(GenerateQuiets, out);
+    out.erase(std::remove_if(out.begin(), out.end(), [this](const Move& move) { return !givesCheck(move); }),
+              out.end());
+}
 
-                if ((offset == 8 || offset == -8) && (fromFile != toFile))
-                    break;
+bool Board::givesCheck(const Move& move) const {
+    const int color = colorTurn;
+    const uint64_t theirKing = bitboards[pieceIndex(-color, BasePieceType::King)];
+    if (!theirKing) return false;
+    const int kingSquare = __builtin_ctzll(theirKing);
+
+    // Occupancy and our pieces as they stand after the move
+    int pieceIndexMoved = getPieceAt(move.startSquare);
+    int movedType = (move.promotionPiece != 0) ? move.promotionPiece % 6 : pieceIndexMoved % 6;
+    int landing = move.targetSquare;
+    uint64_t vacated = 1ULL << move.startSquare;
+    uint64_t landed = 1ULL << move.targetSquare;
+    if (move.isCastling) {
+        // The rook is the piece that can give check
+        landing = castlingKingTarget(move) + ((move.targetSquare > move.startSquare) ? -1 : 1);
+        movedType = BasePieceType::Rook;
+        vacated |= 1ULL << move.targetSquare;
+        landed = (1ULL << castlingKingTarget(move)) | (1ULL << landing);
+    } else if (move.isEnPassant) {
+        vacated |= 1ULL << (move.targetSquare - 8 * color);
+    }
+    uint64_t occupancy = (occupied() & ~vacated) | landed;
+
+    uint64_t direct;
+    switch (movedType) {
+        case BasePieceType::Pawn: direct = PAWN_ATTACKS[color == 1 ? 0 : 1][landing]; break;
+        case BasePieceType::Knight: direct = KNIGHT_ATTACKS[landing]; break;
+        case BasePieceType::Bishop: direct = bishopAttacks(landing, occupancy); break;
+        case BasePieceType::Rook: direct = rookAttacks(landing, occupancy); break;
+        case BasePieceType::Queen: direct = bishopAttacks(landing, occupancy) | rookAttacks(landing, occupancy); break;
+        default: direct = 0; break;  // Kings never give check
+    }
+    if (direct & theirKing) return true;
 
-                uint64_t targetBit = 1ULL << targetSquare;
+    // Discovered checks from the sliders that stayed put
+    uint64_t queens = bitboards[pieceIndex(color, BasePieceType::Queen)];
+    uint64_t diagonal = (bitboards[pieceIndex(color, BasePieceType::Bishop)] | queens) & ~vacated;
+    uint64_t straight = (bitboards[pieceIndex(color, BasePieceType::Rook)] | queens) & ~vacated;
+    return (bishopAttacks(kingSquare, occupancy) & diagonal) || (rookAttacks(kingSquare, occupancy) & straight);
+}
 
-                if (ownPieces & targetBit) {
-                    break;  // Blocked by own piece
-                }
+// Piece values for exchanges, indexed by BasePieceType
+static constexpr int SEE_VALUES[6] = {20000, 900, 330, 320, 500, 100};
 
-                moves.emplace_back(square, targetSquare);
+uint64_t Board::attackersTo(int square, uint64_t occupancy) const {
+    return (attackersTo<1>(square, occupancy) | attackersTo<-1>(square, occupancy)) & occupancy;
+}
 
-                if (opponentPieces & targetBit) {
-                    break;  // Capture and stop
-                }
-            }
+// The least valuable of a side's pieces in attackers, returned as a single bit
+// with its type in type
+uint64_t Board::leastValuableAttacker(uint64_t attackers, int color, int& type) const {
+    for (int baseType : {BasePieceType::Pawn, BasePieceType::Knight, BasePieceType::Bishop,
+                         BasePieceType::Rook, BasePieceType::Queen, BasePieceType::King}) {
+        uint64_t pieces = attackers & bitboards[pieceIndex(color, baseType)];
+        if (pieces) {
+            type = baseType;
+            return pieces & -pieces;
         }
     }
+    type = -1;
+    return 0;
 }
 
-// Queen move generation
-void Board::generateQueenMoves(int queenPieceIndex) {
-    uint64_t queens = bitboards[queenPieceIndex];
-    uint64_t ownPieces = (colorTurn == 1) ? whitePieces : blackPieces;
-    uint64_t opponentPieces = (colorTurn == 1) ? blackPieces : whitePieces;
-
-    static const int queenOffsets[8] = {8, -8, 1, -1, 9, 7, -7, -9};
-
-    while (queens) {
-        int square = __builtin_ctzll(queens);  // Get least significant bit index
-        uint64_t queenBit = 1ULL << square;
-        queens &= ~queenBit;  // Remove this queen from queens
-
-        for (int offset : queenOffsets) {
-            int targetSquare = square;
-            while (true) {
-                int fromFile = targetSquare % 8;
-                int fromRank = targetSquare / 8;
+// Sets up an exchange on the move's target square: the material the move
+// itself wins, the value of the piece left standing there, and the
+// occupancy and attackers once it has moved. Returns false for castling,
+// which exchanges nothing.
+bool Board::beginExchange(const Move& move, int& gain, int& standing, uint64_t& occupancy,
+                          uint64_t& attackers) const {
+    if (move.isCastling) return false;
+
+    const int target = move.targetSquare;
+    int captured = move.isEnPassant ? PieceType::WhitePawn : getPieceAt(target);
+    gain = (captured == -1) ? 0 : SEE_VALUES[captured % 6];
+    standing = SEE_VALUES[getPieceAt(move.startSquare) % 6];
+    if (move.promotionPiece != 0) {
+        gain += SEE_VALUES[move.promotionPiece % 6] - SEE_VALUES[BasePieceType::Pawn];
+        standing = SEE_VALUES[move.promotionPiece % 6];
+    }
 
-                targetSquare += offset;
-                int toFile = targetSquare % 8;
-                int toRank = targetSquare / 8;
+    occupancy = (occupied() & ~(1ULL << move.startSquare)) | (1ULL << target);
+    if (move.isEnPassant) {
+        occupancy &= ~(1ULL << (target - 8 * colorTurn));
+    }
+    attackers = attackersTo(target, occupancy);
+    return true;
+}
 
-                if (targetSquare < 0 || targetSquare >= 64)
-                    break;
+// Sliders behind a piece that just left the target square join the exchange
+uint64_t Board::xrayAttackers(int square, uint64_t occupancy) const {
+    uint64_t queens = bitboards[PieceType::WhiteQueen] | bitboards[PieceType::BlackQueen];
+    uint64_t diagonal = bitboards[PieceType::WhiteBishop] | bitboards[PieceType::BlackBishop] | queens;
+    uint64_t straight = bitboards[PieceType::WhiteRook] | bitboards[PieceType::BlackRook] | queens;
+    return ((bishopAttacks(square, occupancy) & diagonal) | (rookAttacks(square, occupancy) & straight)) &
+           occupancy;
+}
 
-                if ((offset == 1 || offset == -1) && (fromRank != toRank))
-                    break;
+int Board::see(const Move& move) const {
+    int gain[32];
+    int standing;
+    uint64_t occupancy, attackers;
+    if (!beginExchange(move, gain[0], standing, occupancy, attackers)) return 0;
+
+    // Each side recaptures with its least valuable piece while that can pay
+    const int target = move.targetSquare;
+    int depth = 0;
+    for (int side = -colorTurn; depth < 31; side = -side) {
+        uint64_t ownPieces = (side == 1) ? whitePieces : blackPieces;
+        int type;
+        uint64_t attacker = leastValuableAttacker(attackers & ownPieces, side, type);
+        if (!attacker) break;
+        // A king may only recapture a piece nobody else defends
+        if (type == BasePieceType::King && (attackers & ~ownPieces)) break;
+
+        ++depth;
+        gain[depth] = standing - gain[depth - 1];
+
+        occupancy &= ~attacker;
+        attackers = (attackers | xrayAttackers(target, occupancy)) & occupancy;
+        standing = SEE_VALUES[type];
+    }
 
-                if ((offset == 8 || offset == -8) && (fromFile != toFile))
-                    break;
+    // Either side may stop the exchange when continuing would lose
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        --depth;
+    }
+    return gain[0];
+}
 
-                if ((offset == 9 || offset == -9 || offset == 7 || offset == -7) &&
-                    (std::abs(fromFile - toFile) != 1 || std::abs(fromRank - toRank) != 1))
-                    break;
+bool Board::seeGE(const Move& move, int threshold) const {
+    int swap, standing;
+    uint64_t occupancy, attackers;
+    if (!beginExchange(move, swap, standing, occupancy, attackers)) return threshold <= 0;
+
+    // swap is how far the exchange is ahead of the threshold for whoever just
+    // captured, assuming the piece standing on the square is lost next
+    swap -= threshold;
+    if (swap < 0) return false;
+    swap = standing - swap;
+    if (swap <= 0) return true;
+
+    const int target = move.targetSquare;
+    int result = 1;
+    for (int side = -colorTurn;; side = -side) {
+        uint64_t ownPieces = (side == 1) ? whitePieces : blackPieces;
+        int type;
+        uint64_t attacker = leastValuableAttacker(attackers & ownPieces, side, type);
+        if (!attacker) break;
+
+        result ^= 1;
+        if (type == BasePieceType::King) {
+            return (attackers & ~ownPieces) ? result ^ 1 : result;
+        }
+        swap = SEE_VALUES[type] - swap;
+        if (swap < result) break;
 
-                uint64_t targetBit = 1ULL << targetSquare;
+        occupancy &= ~attacker;
+        attackers = (attackers | xrayAttackers(target, occupancy)) & occupancy;
+    }
+    return result;
+}
 
-                if (ownPieces & targetBit) {
-                    break;  // Blocked by own piece
-                }
+bool Board::hasLegalMove() {
+    return (colorTurn == 1) ? findLegalMove<1>() : findLegalMove<-1>();
+}
 
-                moves.emplace_back(square, targetSquare);
+template <int Color>
+bool Board::findLegalMove() {
+    const uint64_t ownPieces = (Color == 1) ? whitePieces : blackPieces;
+    const uint64_t kings = bitboards[pieceIndex(Color, BasePieceType::King)];
+    if (!kings) return false;
+    const int kingSquare = __builtin_ctzll(kings);
+
+    // King steps first: they can be tested without making them, and are the
+    // usual way out of check
+    uint64_t withoutKing = occupied() & ~kings;
+    uint64_t steps = KING_ATTACKS[kingSquare] & ~ownPieces;
+    while (steps) {
+        int targetSquare = __builtin_ctzll(steps);
+        steps &= steps - 1;
+        if (!attackersTo<-Color>(targetSquare, withoutKing)) return true;
+    }
 
-                if (opponentPieces & targetBit) {
-                    break;  // Capture and stop
-                }
+    // Against a double check only the king can move; a single checker can
+    // also be captured or blocked
+    const uint64_t checkers = attackersTo<-Color>(kingSquare, occupied());
+    if (checkers & (checkers - 1)) return false;
+    const uint64_t targets = checkers ? (checkers | squaresBetween(kingSquare, __builtin_ctzll(checkers))) : ~ownPieces;
+
+    // Then one kind of piece at a time, in the reused scratch list, until a
+    // move survives the legality test; the list is left empty for copies
+    auto anyLegal = [this]() {
+        bool found = false;
+        for (const Move& move : legalityScratch) {
+            if (isMoveLegal(move)) {
+                found = true;
+                break;
             }
         }
+        legalityScratch.clear();
+        return found;
+    };
+    if (checkers) {
+        generatePawnMoves<Color, GenerateEvasions>(targets, legalityScratch);
+    } else {
+        generatePawnMoves<Color, GenerateAll>(targets, legalityScratch);
     }
+    if (anyLegal()) return true;
+    generatePieceMoves<Color, BasePieceType::Knight>(targets, legalityScratch);
+    if (anyLegal()) return true;
+    generatePieceMoves<Color, BasePieceType::Bishop>(targets, legalityScratch);
+    if (anyLegal()) return true;
+    generatePieceMoves<Color, BasePieceType::Rook>(targets, legalityScratch);
+    if (anyLegal()) return true;
+    generatePieceMoves<Color, BasePieceType::Queen>(targets, legalityScratch);
+    if (anyLegal()) return true;
+    if (!checkers) generateCastlingMoves<Color>(kingSquare, legalityScratch);
+    return anyLegal();
 }
 
-
-void Board::generatePawnMoves(int pawnPieceIndex) {
-    uint64_t pawns = bitboards[pawnPieceIndex];
-
-    // For each pawn
-    while (pawns) {
-        int square = __builtin_ctzll(pawns);  // Get least significant bit index
-        uint64_t pawnBit = 1ULL << square;
-        pawns &= ~pawnBit;  // Remove this pawn from pawns
-
-        if (colorTurn == 1) {
-            // White pawn moves one square forward
-            int forwardSquare = square + 8;
-            uint64_t forwardBit = 1ULL << forwardSquare;
-            if (!(allPieces & forwardBit)) {
-                // Empty square ahead
-                if (forwardSquare >= 56) {
-                    // Promotion
-                    addPawnPromotionMoves(square, forwardSquare);
-                } else {
-                    moves.emplace_back(square, forwardSquare);
-                    // Two squares forward from rank 2
-                    if (square >= 8 && square < 16) {
-                        int doubleForwardSquare = square + 16;
-                        uint64_t doubleForwardBit = 1ULL << doubleForwardSquare;
-                        if (!(allPieces & doubleForwardBit)) {
-                            moves.emplace_back(square, doubleForwardSquare);
-                        }
-                    }
-                }
-            }
-            // Captures diagonal left
-            if ((square % 8) != 0) {
-                int captureSquare = square + 7;
-                uint64_t captureBit = 1ULL << captureSquare;
-                if (blackPieces & captureBit) {
-                    if (captureSquare >= 56) {
-                        addPawnPromotionMoves(square, captureSquare);
-                    } else {
-                        moves.emplace_back(square, captureSquare);
-                    }
-                } else if (captureSquare == enPassantTarget) {
-                    moves.emplace_back(square, captureSquare, true);
-                }
-            }
-            // Diagonal right
-            if ((square % 8) != 7) {
-                int captureSquare = square + 9;
-                uint64_t captureBit = 1ULL << captureSquare;
-                if (blackPieces & captureBit) {
-                    if (captureSquare >= 56) {
-                        addPawnPromotionMoves(square, captureSquare);
-                    } else {
-                        moves.emplace_back(square, captureSquare);
-                    }
-                } else if (captureSquare == enPassantTarget) {
-                    moves.emplace_back(square, captureSquare, true);
-                }
-            }
-        } else {
-            // Black pawn moves one square forward
-            int forwardSquare = square - 8;
-            uint64_t forwardBit = 1ULL << forwardSquare;
-            if (!(allPieces & forwardBit)) {
-                // Empty square ahead
-                if (forwardSquare < 8) {
-                    // Promotion
-                    addPawnPromotionMoves(square, forwardSquare);
-                } else {
-                    moves.emplace_back(square, forwardSquare);
-                    // Two squares forward from rank 7
-                    if (square >= 48 && square < 56) {
-                        int doubleForwardSquare = square - 16;
-                        uint64_t doubleForwardBit = 1ULL << doubleForwardSquare;
-                        if (!(allPieces & doubleForwardBit)) {
-                            moves.emplace_back(square, doubleForwardSquare);
-                        }
-                    }
-                }
-            }
-            // Captures
-            // Diagonal left
-            if ((square % 8) != 0) {
-                int captureSquare = square - 9;
-                uint64_t captureBit = 1ULL << captureSquare;
-                if (whitePieces & captureBit) {
-                    if (captureSquare < 8) {
-                        addPawnPromotionMoves(square, captureSquare);
-                    } else {
-                        moves.emplace_back(square, captureSquare);
-                    }
-                } else if (captureSquare == enPassantTarget) {
-                    moves.emplace_back(square, captureSquare, true);
-                }
-            }
-            // Diagonal right
-            if ((square % 8) != 7) {
-                int captureSquare = square - 7;
-                uint64_t captureBit = 1ULL << captureSquare;
-                if (whitePieces & captureBit) {
-                    if (captureSquare < 8) {
-                        addPawnPromotionMoves(square, captureSquare);
-                    } else {
-                        moves.emplace_back(square, captureSquare);
-                    }
-                } else if (captureSquare == enPassantTarget) {
-                    moves.emplace_back(square, captureSquare, true);
-                }
-            }
+template <int Color, MoveGenType Type>
+void Board::generate(std::vector<Move>& list) const {
+    const uint64_t ownPieces = (Color == 1) ? whitePieces : blackPieces;
+    const uint64_t opponentPieces = (Color == 1) ? blackPieces : whitePieces;
+    const uint64_t kings = bitboards[pieceIndex(Color, BasePieceType::King)];
+    const int kingSquare = kings ? __builtin_ctzll(kings) : -1;
+
+    uint64_t targets = (Type == GenerateCaptures) ? opponentPieces
+                     : (Type == GenerateQuiets)   ? ~occupied()
+                                                  : ~ownPieces;
+    uint64_t kingTargets = targets;
+
+    if (Type == GenerateEvasions && kingSquare != -1) {
+        // Against a double check only the king can move; a single checker can
+        // also be captured or blocked
+        uint64_t checkers = attackersTo<-Color>(kingSquare, occupied());
+        if (checkers & (checkers - 1)) {
+            targets = 0;
+        } else if (checkers) {
+            int checker = __builtin_ctzll(checkers);
+            targets = checkers | squaresBetween(kingSquare, checker);
         }
     }
-}
 
-void Board::addPawnPromotionMoves(int startSquare, int targetSquare) {
-    if (colorTurn == 1) {
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::WhiteQueen);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::WhiteRook);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::WhiteBishop);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::WhiteKnight);
-    } else {
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::BlackQueen);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::BlackRook);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::BlackBishop);
-        moves.emplace_back(startSquare, targetSquare, false, PieceType::BlackKnight);
+    if (targets) {
+        generatePawnMoves<Color, Type>(targets, list);
+        generatePieceMoves<Color, BasePieceType::Knight>(targets, list);
+        generatePieceMoves<Color, BasePieceType::Bishop>(targets, list);
+        generatePieceMoves<Color, BasePieceType::Rook>(targets, list);
+        generatePieceMoves<Color, BasePieceType::Queen>(targets, list);
     }
-}
-
-bool Board::isSquareAttacked(int square, int attackingColor) const {
-    uint64_t targetBit = 1ULL << square;
-    uint64_t opponentPawns = (attackingColor == 1) ? bitboards[PieceType::WhitePawn] : bitboards[PieceType::BlackPawn];
-    uint64_t opponentKnights = (attackingColor == 1) ? bitboards[PieceType::WhiteKnight] : bitboards[PieceType::BlackKnight];
-    uint64_t opponentBishops = (attackingColor == 1) ? bitboards[PieceType::WhiteBishop] : bitboards[PieceType::BlackBishop];
-    uint64_t opponentRooks = (attackingColor == 1) ? bitboards[PieceType::WhiteRook] : bitboards[PieceType::BlackRook];
-    uint64_t opponentQueens = (attackingColor == 1) ? bitboards[PieceType::WhiteQueen] : bitboards[PieceType::BlackQueen];
-    uint64_t opponentKing = (attackingColor == 1) ? bitboards[PieceType::WhiteKing] : bitboards[PieceType::BlackKing];
-
-    // Pawn attacks
-    if (attackingColor == 1) {  // White pawn attacks
-        uint64_t pawnAttacks = ((opponentPawns & ~FILE_H) << 9) | ((opponentPawns & ~FILE_A) << 7);
-        if (pawnAttacks & targetBit) return true;
-    } else {  // Black pawn attacks
-        uint64_t pawnAttacks = ((opponentPawns & ~FILE_A) >> 9) | ((opponentPawns & ~FILE_H) >> 7);
-        if (pawnAttacks & targetBit) return true;
-    }
-
-    // Knight attacks
-    uint64_t knightAttackers = 0ULL;
-    uint64_t knights = opponentKnights;
-    while (knights) {
-        int knightSquare = __builtin_ctzll(knights);
-        knights &= ~(1ULL << knightSquare);
-        knightAttackers |= knightAttackBitboard(knightSquare);
-    }
-    if (knightAttackers & targetBit) return true;
-
-    // King attacks
-    uint64_t kingAttackers = 0ULL;
-    uint64_t kings = opponentKing;
-    while (kings) {
-        int kingSquare = __builtin_ctzll(kings);
-        kings &= ~(1ULL << kingSquare);
-        kingAttackers |= kingAttackBitboard(kingSquare);
+    generatePieceMoves<Color, BasePieceType::King>(kingTargets, list);
+    if ((Type == GenerateAll || Type == GenerateQuiets) && kingSquare != -1) {
+        generateCastlingMoves<Color>(kingSquare, list);
     }
-    if (kingAttackers & targetBit) return true;
+}
 
-    // Bishop and Queen attacks
-    uint64_t bishopAttackers = opponentBishops | opponentQueens;
-    if (bishopAttackBitboard(square, allPieces) & bishopAttackers) return true;
+template <int Color, int BaseType>
+void Board::generatePieceMoves(uint64_t targets, std::vector<Move>& list) const {
+    uint64_t pieces = bitboards[pieceIndex(Color, BaseType)];
 
-    // Rook and Queen attacks
-    uint64_t rookAttackers = opponentRooks | opponentQueens;
-    if (rookAttackBitboard(square, allPieces) & rookAttackers) return true;
+    while (pieces) {
+        int square = __builtin_ctzll(pieces);
+        pieces &= pieces - 1;
 
-    return false;
+        uint64_t attacks = pieceAttacks<BaseType>(square, occupied()) & targets;
+        while (attacks) {
+            int targetSquare = __builtin_ctzll(attacks);
+            attacks &= attacks - 1;
+            list.emplace_back(square, targetSquare);
+        }
+    }
 }
 
-uint64_t Board::bishopAttackBitboard(int square, uint64_t occupancy) const {
-    uint64_t attacks = 0ULL;
-    static const int bishopOffsets[4] = {9, 7, -7, -9};
-
-    for (int offset : bishopOffsets) {
-        int targetSquare = square;
-        while (true) {
-            int fromFile = targetSquare % 8;
-            int fromRank = targetSquare / 8;
-
-            targetSquare += offset;
-            int toFile = targetSquare % 8;
-            int toRank = targetSquare / 8;
+template <int Color, MoveGenType Type>
+void Board::generatePawnMoves(uint64_t targets, std::vector<Move>& list) const {
+    constexpr int up = (Color == 1) ? 8 : -8;
+    constexpr int captureWest = (Color == 1) ? 7 : -9;
+    constexpr int captureEast = (Color == 1) ? 9 : -7;
+    constexpr uint64_t promotionRank = (Color == 1) ? RANK_8 : RANK_1;
+    constexpr uint64_t firstPushRank = (Color == 1) ? RANK_3 : RANK_6;
+
+    const uint64_t pawns = bitboards[pieceIndex(Color, BasePieceType::Pawn)];
+    const uint64_t opponentPieces = (Color == 1) ? blackPieces : whitePieces;
+    const uint64_t empty = ~occupied();
+
+    uint64_t singlePushes = shift<up>(pawns) & empty;
+    uint64_t doublePushes = shift<up>(singlePushes & firstPushRank) & empty;
+    uint64_t westCaptures = shift<captureWest>(pawns & ~FILE_A) & opponentPieces & targets;
+    uint64_t eastCaptures = shift<captureEast>(pawns & ~FILE_H) & opponentPieces & targets;
+    if (Type == GenerateEvasions) {
+        // Pushes already land on empty squares, which is all the other types
+        // ask of them; quiet promotions belong to the captures
+        singlePushes &= targets;
+        doublePushes &= targets;
+    }
 
-            if (targetSquare < 0 || targetSquare >= 64 ||
-                std::abs(fromFile - toFile) != 1 || std::abs(fromRank - toRank) != 1)
-                break;
+    auto addMoves = [&list](uint64_t destinations, int offset) {
+        while (destinations) {
+            int targetSquare = __builtin_ctzll(destinations);
+            destinations &= destinations - 1;
+            list.emplace_back(targetSquare - offset, targetSquare);
+        }
+    };
+    auto addPromotions = [&list](uint64_t destinations, int offset) {
+        while (destinations) {
+            int targetSquare = __builtin_ctzll(destinations);
+            destinations &= destinations - 1;
+            for (int baseType : {BasePieceType::Queen, BasePieceType::Rook, BasePieceType::Bishop,
+                                 BasePieceType::Knight}) {
+                list.emplace_back(targetSquare - offset, targetSquare, false, pieceIndex(Color, baseType));
+            }
+        }
+    };
 
-            uint64_t targetBit = 1ULL << targetSquare;
-            attacks |= targetBit;
+    if (Type != GenerateCaptures) {
+        addMoves(singlePushes & ~promotionRank, up);
+        addMoves(doublePushes, 2 * up);
+    }
 
-            if (occupancy & targetBit) break;  // Blocked
+    if (Type != GenerateQuiets) {
+        addPromotions(singlePushes & promotionRank, up);
+        addPromotions(westCaptures & promotionRank, captureWest);
+        addPromotions(eastCaptures & promotionRank, captureEast);
+        addMoves(westCaptures & ~promotionRank, captureWest);
+        addMoves(eastCaptures & ~promotionRank, captureEast);
+
+        // Left to the legality test even when evading, since the captured
+        // pawn need not stand on a target square
+        if (enPassantTarget != -1) {
+            uint64_t capturers = PAWN_ATTACKS[Color == 1 ? 1 : 0][enPassantTarget] & pawns;
+            while (capturers) {
+                int square = __builtin_ctzll(capturers);
+                capturers &= capturers - 1;
+                list.emplace_back(square, enPassantTarget, true);
+            }
         }
     }
-    return attacks;
 }
 
-uint64_t Board::rookAttackBitboard(int square, uint64_t occupancy) const {
-    uint64_t attacks = 0ULL;
-    static const int rookOffsets[4] = {8, -8, 1, -1};
-
-    for (int offset : rookOffsets) {
-        int targetSquare = square;
-        while (true) {
-            int fromFile = targetSquare % 8;
-            int fromRank = targetSquare / 8;
-
-            targetSquare += offset;
-            int toFile = targetSquare % 8;
-            int toRank = targetSquare / 8;
+// Squares from a to b inclusive on one rank
+static uint64_t rankSpan(int a, int b) {
+    int low = std::min(a, b);
+    int high = std::max(a, b);
+    return ((2ULL << high) - 1) & ~((1ULL << low) - 1);
+}
 
-            if (targetSquare < 0 || targetSquare >= 64 ||
-                ((offset == 1 || offset == -1) && (fromRank != toRank)))
+template <int Color>
+void Board::generateCastlingMoves(int kingSquare, std::vector<Move>& list) const {
+    constexpr int firstRight = (Color == 1) ? CastlingRight::WhiteKingside : CastlingRight::BlackKingside;
+    const uint64_t ownRooks = bitboards[pieceIndex(Color, BasePieceType::Rook)];
+
+    for (int right = firstRight; right < firstRight + 2; ++right) {
+        int rookSquare = castlingRooks[right];
+        if (rookSquare == -1 || !(ownRooks & (1ULL << rookSquare))) continue;
+
+        Move castle(kingSquare, rookSquare, false, 0, true);
+        int kingTarget = castlingKingTarget(castle);
+        int rookTarget = kingTarget + ((rookSquare > kingSquare) ? -1 : 1);
+
+        // Everything the king and rook pass over must be empty, apart from themselves
+        uint64_t path = rankSpan(kingSquare, kingTarget) | rankSpan(rookSquare, rookTarget);
+        path &= ~((1ULL << kingSquare) | (1ULL << rookSquare));
+        if (occupied() & path) continue;
+
+        // The king may not castle out of, through or into check. Its own square
+        // is tested even when it does not move, since callers other than
+        // generateMoves do not switch to evasions in check.
+        bool throughCheck = false;
+        int step = (kingTarget > kingSquare) ? 1 : -1;
+        for (int square = kingSquare;; square += step) {
+            if (attackersTo<-Color>(square, occupied())) {
+                throughCheck = true;
                 break;
-
-            uint64_t targetBit = 1ULL << targetSquare;
-            attacks |= targetBit;
-
-            if (occupancy & targetBit) break;  // Blocked
+            }
+            if (square == kingTarget) break;
         }
+        if (throughCheck) continue;
+
+        list.push_back(castle);
     }
-    return attacks;
 }
 
-bool Board::isStalemate() const {
-    if (isKingInCheck(colorTurn)) {
-        return false;
-    }
-    return moves.empty();
+template <int Color>
+uint64_t Board::attackersTo(int square, uint64_t occupancy) const {
+    // A pawn attacks a square from where a pawn of the other side on that
+    // square would attack it
+    const uint64_t queens = bitboards[pieceIndex(Color, BasePieceType::Queen)];
+    return (PAWN_ATTACKS[Color == 1 ? 1 : 0][square] & bitboards[pieceIndex(Color, BasePieceType::Pawn)]) |
+           (KNIGHT_ATTACKS[square] & bitboards[pieceIndex(Color, BasePieceType::Knight)]) |
+           (KING_ATTACKS[square] & bitboards[pieceIndex(Color, BasePieceType::King)]) |
+           (bishopAttacks(square, occupancy) & (bitboards[pieceIndex(Color, BasePieceType::Bishop)] | queens)) |
+           (rookAttacks(square, occupancy) & (bitboards[pieceIndex(Color, BasePieceType::Rook)] | queens));
+}
+
+bool Board::isSquareAttacked(int square, int attackingColor) const {
+    return (attackingColor == 1) ? attackersTo<1>(square, occupied()) != 0
+                                 : attackersTo<-1>(square, occupied()) != 0;
 }
 
 bool Board::isThreefoldRepetition() const {
-    if (positionHistory.size() < 8) {
-        return false;
-    }
-    
-    std::string currentPosition = boardToEPD();
-    int repetitionCount = 0;
-    
-    for (const auto& position : positionHistory) {
-        if (position == currentPosition) {
-            repetitionCount++;
-            if (repetitionCount >= 3) {
-                return true;
-            }
+    // Only positions since the last capture or pawn move can repeat, and only
+    // those with the same side to move
+    size_t current = positionHistory.size() - 1;
+    size_t reversible = std::min<size_t>(halfMoveClock, current);
+    int repetitionCount = 1;
+    for (size_t back = 4; back <= reversible; back += 2) {
+        if (positionHistory[current - back] == positionHistory[current] && ++repetitionCount >= 3) {
+            return true;
         }
     }
-    
     return false;
 }
 
-bool Board::isFiftyMoveRule() const {
-    return halfMoveClock >= 100;
+bool Board::isInsufficientMaterial() const {
+    if (bitboards[PieceType::WhitePawn] | bitboards[PieceType::BlackPawn] |
+        bitboards[PieceType::WhiteRook] | bitboards[PieceType::BlackRook] |
+        bitboards[PieceType::WhiteQueen] | bitboards[PieceType::BlackQueen]) {
+        return false;
+    }
+
+    // A lone minor piece, or bishops that all stand on one colour, cannot mate
+    const uint64_t darkSquares = 0xAA55AA55AA55AA55ULL;
+    uint64_t knights = bitboards[PieceType::WhiteKnight] | bitboards[PieceType::BlackKnight];
+    uint64_t bishops = bitboards[PieceType::WhiteBishop] | bitboards[PieceType::BlackBishop];
+    if (__builtin_popcountll(knights | bishops) <= 1) return true;
+    return knights == 0 && ((bishops & darkSquares) == 0 || (bishops & ~darkSquares) == 0);
 }
 
-bool Board::isDraw() const {
-    return isStalemate() || isThreefoldRepetition() || isFiftyMoveRule();
+void Board::updateStatus(bool movesGenerated) {
+    TRACE_ZONE("Board::updateStatus");
+    if (movesGenerated ? moves.empty() : !hasLegalMove()) {
+        status = isKingInCheck(colorTurn) ? GameStatus::Checkmate : GameStatus::Stalemate;
+    } else if (halfMoveClock >= 100) {
+        status = GameStatus::FiftyMoves;
+    } else if (isThreefoldRepetition()) {
+        status = GameStatus::Repetition;
+    } else if (isInsufficientMaterial()) {
+        status = GameStatus::InsufficientMaterial;
+    } else {
+        status = GameStatus::Ongoing;
+    }
 }
 
 bool Board::isMoveLegal(const Move& move) {
@@ -848,16 +1262,9 @@ bool Board::isMoveLegal(const Move& move) {
 
 
     // Save the current state
-    auto savedBitboards = bitboards;
-    auto savedWhitePieces = whitePieces;
-    auto savedBlackPieces = blackPieces;
-    auto savedAllPieces = allPieces;
-    int savedEnPassantTarget = enPassantTarget;
-    bool savedCanWhiteCastleKingside = canWhiteCastleKingside;
-    bool savedCanWhiteCastleQueenside = canWhiteCastleQueenside;
-    bool savedCanBlackCastleKingside = canBlackCastleKingside;
-    bool savedCanBlackCastleQueenside = canBlackCastleQueenside;
+    const Position saved = *this;
     int savedColorTurn = colorTurn;
+    int savedFullMoveNumber = fullMoveNumber;
 
     // Make the move
     makeMove(move, false);
@@ -872,16 +1279,8 @@ bool Board::isMoveLegal(const Move& move) {
     }
 
     // Revert the move
-    bitboards = savedBitboards;
-    whitePieces = savedWhitePieces;
-    blackPieces = savedBlackPieces;
-    allPieces = savedAllPieces;
-    enPassantTarget = savedEnPassantTarget;
-    canWhiteCastleKingside = savedCanWhiteCastleKingside;
-    canWhiteCastleQueenside = savedCanWhiteCastleQueenside;
-    canBlackCastleKingside = savedCanBlackCastleKingside;
-    canBlackCastleQueenside = savedCanBlackCastleQueenside;
-    colorTurn = savedColorTurn;
+    static_cast<Position&>(*this) = saved;
+    fullMoveNumber = savedFullMoveNumber;
 
     return !inCheck;
 }
@@ -896,11 +1295,7 @@ bool Board::isKingInCheck(int color) const {
     return false;  // King is not on the board (should not happen)
 }
 
-bool Board::isCheckmate() {
-    return moves.empty() && isKingInCheck(colorTurn);
-}
-
-uint64_t Board::computeHash() const {
+uint64_t Board::computeHashFromScratch() const {
     uint64_t hash = 0ULL;
 
     // Using random numbers for each piece on each square
@@ -913,10 +1308,9 @@ uint64_t Board::computeHash() const {
         }
     }
 
-    if (canWhiteCastleKingside) hash ^= zobristCastle[0];
-    if (canWhiteCastleQueenside) hash ^= zobristCastle[1];
-    if (canBlackCastleKingside) hash ^= zobristCastle[2];
-    if (canBlackCastleQueenside) hash ^= zobristCastle[3];
+    for (int right = 0; right < 4; ++right) {
+        if (castlingRooks[right] != -1) hash ^= zobristCastle[right];
+    }
     if (enPassantTarget != -1) hash ^= zobristEnPassant[enPassantTarget % 8];
     if (colorTurn == -1) hash ^= zobristBlackToMove;
 
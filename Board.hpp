@@ -2,19 +2,23 @@
 #define BOARD_HPP
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "Piece.hpp"
 
+struct PackedPosition;
+
 struct Move {
     int startSquare;     // 0..63
     int targetSquare;    // 0..63
     bool isEnPassant;
     int promotionPiece;  // PieceType index or 0
-    bool isCastling;
+    bool isCastling;     // Encoded as the king capturing its own rook (Chess960 style)
 
     // Add this default constructor
     Move() : startSquare(-1), targetSquare(-1), isEnPassant(false), promotionPiece(0), isCastling(false) {}
@@ -27,75 +31,199 @@ struct Move {
           isCastling(isCastling) {}
 };
 
-class Board {
-   private:
+// Large enough for any FEN written by Board::writeFEN, including the terminator
+constexpr size_t FEN_BUFFER_SIZE = 128;
 
-    // Bitboards for convenience
+// Castling right indexes, shared with the Zobrist castling keys
+enum CastlingRight {
+    WhiteKingside = 0,
+    WhiteQueenside,
+    BlackKingside,
+    BlackQueenside
+};
+
+// Result of the position for the side to move, worked out once per move
+enum class GameStatus {
+    Ongoing,
+    Checkmate,
+    Stalemate,
+    Repetition,
+    FiftyMoves,
+    InsufficientMaterial
+};
+
+// Moves a generator produces. Captures include every promotion and en
+// passant; quiets are all other moves, castling among them. Evasions are the
+// moves that can answer a check: king moves, and with a single checker,
+// captures of it and interpositions.
+enum MoveGenType {
+    GenerateAll,
+    GenerateCaptures,
+    GenerateQuiets,
+    GenerateEvasions
+};
+
+// Everything that identifies a position, in two cache lines and without heap
+// storage: copying one is a memcpy, and it can be kept in arrays and written
+// to files as it is. Game history, move lists and the full move number live
+// on Board. A mailbox would take a third cache line, so the piece on a square
+// is still looked up in the bitboards.
+struct alignas(64) Position {
+    // Bitboards for each piece type and color
+    std::array<uint64_t, 12> bitboards;  // Indexes correspond to PieceType enum
     uint64_t whitePieces;
     uint64_t blackPieces;
-    uint64_t allPieces;
+    uint64_t hash;  // Zobrist key, kept up to date by Board::makeMove
+
+    // Start square of the rook for each CastlingRight, or -1 once the right is lost
+    std::array<int8_t, 4> castlingRooks;
+    int8_t enPassantTarget;  // Square index (0-63) or -1
+    int8_t colorTurn;        // 1 for white, -1 for black
+    uint16_t halfMoveClock;  // Saturates at 65535
+
+    uint64_t occupied() const { return whitePieces | blackPieces; }
+};
+
+static_assert(sizeof(Position) == 128, "Position must stay two cache lines");
+static_assert(std::is_trivially_copyable<Position>::value, "Position must be copyable with memcpy");
+
+// What Board::makeSearchMove changes beyond the position, so
+// Board::undoSearchMove can put it back
+struct SearchUndo {
+    Position position;
+    Move lastMove;
+    int fullMoveNumber;
+    GameStatus status;
+};
+
+class Board : public Position {
+   private:
 
     // Helper functions
     int charToPieceIndex(char c) const;
     char pieceIndexToChar(int pieceIndex) const;
     void updateAggregateBitboards();
 
-    // Move generation helper functions
-    void generatePawnMoves(int pawnPieceIndex);
-    void generateKnightMoves(int knightPieceIndex);
-    void generateBishopMoves(int bishopPieceIndex);
-    void generateRookMoves(int rookPieceIndex);
-    void generateQueenMoves(int queenPieceIndex);
-    void generateKingMoves(int kingPieceIndex);
-
-    void addPawnPromotionMoves(int startSquare, int targetSquare);
-
-    uint64_t knightAttackBitboard(int square) const;
-    uint64_t kingAttackBitboard(int square) const;
-    uint64_t bishopAttackBitboard(int square, uint64_t occupancy) const;
-    uint64_t rookAttackBitboard(int square, uint64_t occupancy) const;
-    uint64_t queenAttackBitboard(int square, uint64_t occupancy) const;
+    // Move generation, instantiated for each side to move (1 white, -1 black)
+    // and generation type so the per-piece loops carry no colour branches.
+    // Pseudo-legal moves are appended to list.
+    template <int Color, MoveGenType Type> void generate(std::vector<Move>& list) const;
+    template <int Color, MoveGenType Type> void generatePawnMoves(uint64_t targets, std::vector<Move>& list) const;
+    template <int Color, int BaseType> void generatePieceMoves(uint64_t targets, std::vector<Move>& list) const;
+    template <int Color> void generateCastlingMoves(int kingSquare, std::vector<Move>& list) const;
+
+    // Pieces of the given colour attacking a square with the given occupancy
+    template <int Color> uint64_t attackersTo(int square, uint64_t occupancy) const;
     bool isSquareAttacked(int square, int attackingColor) const;
 
+    // Static exchange helpers; see Board::see
+    uint64_t attackersTo(int square, uint64_t occupancy) const;
+    uint64_t leastValuableAttacker(uint64_t attackers, int color, int& type) const;
+    uint64_t xrayAttackers(int square, uint64_t occupancy) const;
+    bool beginExchange(const Move& move, int& gain, int& standing, uint64_t& occupancy,
+                       uint64_t& attackers) const;
+
     bool isMoveLegal(const Move& move);
 
-    std::vector<std::string> positionHistory;
-    int halfMoveClock;
+    std::vector<uint64_t> positionHistory;  // Zobrist keys of every position so far
+    std::vector<Move> legalityScratch;      // Candidates of findLegalMove, kept for its capacity
+    int fullMoveNumber;
+    GameStatus status = GameStatus::Ongoing;
 
-    bool isStalemate() const;
-    bool isThreefoldRepetition() const;
-    bool isFiftyMoveRule() const;
+    uint64_t computeHashFromScratch() const;
+    bool losesCastlingRight(int right, int pieceIndex, const Move& move) const;
 
-   public:
-    // Bitboards for each piece type and color
-    std::array<uint64_t, 12> bitboards;  // Indexes correspond to PieceType enum
+    void applyMove(const Move& move, uint64_t key, bool updateMoves);
+    bool hasOneKingEach() const;
+    void parseCastling(std::string_view field);
+    void resetHistory(bool updateMoves);
+    size_t writePlacement(char* buffer) const;
+    size_t writeEPD(char* buffer, bool shredder) const;
 
+    bool isThreefoldRepetition() const;
+    bool isInsufficientMaterial() const;
+    void updateStatus(bool movesGenerated);
+    template <int Color> bool findLegalMove();
 
-    int colorTurn;  // 1 for white, -1 for black
-    std::string castleStatus;
+   public:
     std::vector<Move> moves;
     Move lastMove;
-    int enPassantTarget;  // Square index (0-63) or -1
 
-    explicit Board(const std::string& epd);
+    // Accepts FEN, X-FEN, Shredder-FEN and EPD. Missing trailing fields default
+    // to white to move, castling with the outermost rooks, no en passant.
+    explicit Board(std::string_view fen);
+
+    // Resets the board from a FEN without allocating new storage. With
+    // updateMoves false the legal move list and history are left empty, which is
+    // what bulk position loading wants.
+    void loadFEN(std::string_view fen, bool updateMoves = true);
+
+    // Writes a NUL-terminated FEN into a buffer of at least FEN_BUFFER_SIZE bytes
+    // and returns its length. Castling uses KQkq for outermost rooks and rook
+    // files otherwise (X-FEN), or always rook files when shredder is set.
+    size_t writeFEN(char* buffer, bool shredder = false) const;
+    std::string toFEN(bool shredder = false) const;
+
+    // Round trip through the 32-byte binary format used by position files
+    PackedPosition pack() const;
+    void loadPacked(const PackedPosition& packed, bool updateMoves = true);
 
     void makeMove(const Move& move, bool updateMoves = true);
+    // Makes a move for search: history and game status are kept current, with
+    // mate and stalemate found by hasLegalMove, but moves is left empty for the
+    // caller to generate what it needs with generateLegalMoves. The returned
+    // record takes the move back with undoSearchMove, so a search can work on
+    // one board instead of copying it for every child.
+    SearchUndo makeSearchMove(const Move& move);
+    // Same, with the key already worked out by keyAfter(move), as a search
+    // has it from prefetching the child's table entry
+    SearchUndo makeSearchMove(const Move& move, uint64_t key);
+    void undoSearchMove(const SearchUndo& undo);
     bool isLastMoveTile(int tileIndex) const;
     std::string boardToEPD() const;
     void generateMoves();
 
+    // Legal moves of one kind for the side to move, replacing the contents of
+    // out; moves itself is left alone. Captures and quiets together are all
+    // legal moves. Evasions are meant for positions in check, where they are
+    // all legal moves and far fewer are tried.
+    void generateLegalMoves(MoveGenType type, std::vector<Move>& out);
+    // Legal quiet moves that give check, directly or by discovery
+    void generateQuietChecks(std::vector<Move>& out);
+    // Whether a legal move checks the opponent, worked out without making it
+    bool givesCheck(const Move& move) const;
+    // Whether the side to move has any legal move, stopping at the first one
+    bool hasLegalMove();
+
+    // Static exchange evaluation: the material the side to move ends up with
+    // (in centipawns) from the captures a move starts on its target square,
+    // each side recapturing with its least valuable attacker, sliders joining
+    // from behind as the square's attackers are used up, and either side free
+    // to stop. Pins are ignored. seeGE answers see(move) >= threshold and
+    // stops as soon as the outcome is known.
+    int see(const Move& move) const;
+    bool seeGE(const Move& move, int threshold) const;
+
+    // Square the king ends up on for a castling move
+    static int castlingKingTarget(const Move& move);
+
     // Helper methods
     int getPieceAt(int square) const;  // Returns PieceType index or -1 if empty
 
-    bool canWhiteCastleKingside;
-    bool canWhiteCastleQueenside;
-    bool canBlackCastleKingside;
-    bool canBlackCastleQueenside;
-
     bool isKingInCheck(int color) const;
-    bool isCheckmate();
-    bool isDraw() const;
-    uint64_t computeHash() const;
+
+    // Cached when the position is set up or a move is made with updateMoves,
+    // so these cost nothing to call repeatedly
+    GameStatus getStatus() const { return status; }
+    bool isCheckmate() const { return status == GameStatus::Checkmate; }
+    bool isDraw() const { return status != GameStatus::Ongoing && status != GameStatus::Checkmate; }
+    uint64_t computeHash() const { return hash; }
+    // Hash of the position after a legal move, without making it, so the
+    // search can prefetch the child's table entry early
+    uint64_t keyAfter(const Move& move) const;
+
+    // Plies since the last capture or pawn move
+    int getHalfMoveClock() const { return halfMoveClock; }
 };
 
 #endif  // BOARD_HPP
@@ -0,0 +1,227 @@
+#include "BookBuilder.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Board.hpp"
+#include "MappedFile.hpp"
+#include "Notation.hpp"
+#include "OpeningBook.hpp"
+
+static const char* const STANDARD_START = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct BookSample {
+    uint64_t key;  // Polyglot key until the book's format is known
+    uint64_t engineKey;
+    uint16_t move;
+    uint8_t points;  // 2 win, 1 draw, 0 loss for the side that played the move
+};
+
+struct BookStats {
+    uint64_t key;
+    uint16_t move;
+    uint32_t games;
+    uint32_t points;
+};
+
+// Replays one game's movetext up to maxPlies and appends its samples
+class GameReplay {
+public:
+    GameReplay(std::vector<BookSample>& samples, int maxPlies) : samples(samples), maxPlies(maxPlies) {}
+
+    void setTag(std::string_view name, std::string_view value) {
+        if (name == "FEN") fen.assign(value);
+    }
+
+    void addMove(std::string_view san) {
+        if (failed || plies >= maxPlies) return;
+        if (!board) board = std::make_unique<Board>(fen.empty() ? STANDARD_START : fen);
+
+        Move move;
+        if (!parseSAN(*board, san, move)) {
+            std::cerr << "Skipping rest of game at unknown move " << san << std::endl;
+            failed = true;
+            return;
+        }
+        if (!hasStandardCastling(*board)) chess960 = true;
+        gameSamples.push_back({polyglotKey(*board), board->computeHash(), encodeBookMove(move), 0});
+        gameMovers.push_back(board->colorTurn);
+        board->makeMove(move);
+        ++plies;
+    }
+
+    // result is 1, 0 or -1 from white's side; unfinished games are dropped
+    void finish(bool hasResult, int result) {
+        if (hasResult) {
+            for (size_t i = 0; i < gameSamples.size(); ++i) {
+                gameSamples[i].points = static_cast<uint8_t>(gameMovers[i] * result + 1);
+                samples.push_back(gameSamples[i]);
+            }
+            ++games;
+        }
+        gameSamples.clear();
+        gameMovers.clear();
+        board.reset();
+        fen.clear();
+        failed = false;
+        plies = 0;
+    }
+
+    size_t gameCount() const { return games; }
+
+    // Whether any game reached a position Polyglot keys cannot describe
+    bool hasChess960Games() const { return chess960; }
+
+private:
+    std::vector<BookSample>& samples;
+    std::vector<BookSample> gameSamples;
+    std::vector<int> gameMovers;
+    std::unique_ptr<Board> board;
+    std::string fen;
+    int maxPlies;
+    int plies = 0;
+    bool failed = false;
+    bool chess960 = false;
+    size_t games = 0;
+};
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Walks the PGN text: tag pairs, movetext, comments, variations and NAGs
+static void parsePGN(std::string_view text, GameReplay& replay) {
+    size_t pos = 0;
+    bool inMoves = false;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (isSpace(c)) {
+            ++pos;
+        } else if (c == '[') {
+            if (inMoves) {
+                replay.finish(false, 0);  // Previous game had no result token
+                inMoves = false;
+            }
+            size_t end = text.find(']', pos);
+            if (end == std::string_view::npos) break;
+            std::string_view tag = text.substr(pos + 1, end - pos - 1);
+            size_t nameEnd = tag.find(' ');
+            size_t open = tag.find('"');
+            size_t close = tag.rfind('"');
+            if (nameEnd != std::string_view::npos && open != close) {
+                replay.setTag(tag.substr(0, nameEnd), tag.substr(open + 1, close - open - 1));
+            }
+            pos = end + 1;
+        } else if (c == '{') {
+            size_t end = text.find('}', pos);
+            pos = (end == std::string_view::npos) ? text.size() : end + 1;
+        } else if (c == ';') {
+            size_t end = text.find('\n', pos);
+            pos = (end == std::string_view::npos) ? text.size() : end + 1;
+        } else if (c == '(') {
+            int depth = 0;
+            for (; pos < text.size(); ++pos) {
+                if (text[pos] == '(') ++depth;
+                if (text[pos] == ')' && --depth == 0) break;
+            }
+            ++pos;
+        } else {
+            size_t end = pos;
+            while (end < text.size() && !isSpace(text[end]) && text[end] != '{' && text[end] != '(' &&
+                   text[end] != ';') {
+                ++end;
+            }
+            std::string_view token = text.substr(pos, end - pos);
+            pos = end;
+            inMoves = true;
+
+            if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+                int result = (token == "1-0") ? 1 : (token == "0-1") ? -1 : 0;
+                replay.finish(token != "*", result);
+                inMoves = false;
+                continue;
+            }
+            if (token.front() == '$') continue;  // Numeric annotation glyph
+
+            // Move numbers may be glued to the move: 12.e4, 12...Nf6
+            size_t start = 0;
+            while (start < token.size() && token[start] >= '0' && token[start] <= '9') ++start;
+            if (start > 0 && start < token.size() && token[start] == '.') {
+                while (start < token.size() && token[start] == '.') ++start;
+                token.remove_prefix(start);
+            }
+            if (!token.empty()) replay.addMove(token);
+        }
+    }
+    if (inMoves) replay.finish(false, 0);
+}
+
+int buildOpeningBook(const BookBuildOptions& options) {
+    MappedFile input(options.inputPath);
+    input.adviseSequential();
+    std::string_view text(reinterpret_cast<const char*>(input.data()), input.size());
+
+    std::vector<BookSample> samples;
+    GameReplay replay(samples, options.maxPlies);
+    parsePGN(text, replay);
+
+    // Standard games make a Polyglot book; any Chess960 castling setup needs
+    // the engine's keys, which tell the setups apart
+    bool chess960 = replay.hasChess960Games();
+    if (chess960) {
+        for (BookSample& sample : samples) sample.key = sample.engineKey;
+    }
+
+    // Merge identical (position, move) pairs
+    std::sort(samples.begin(), samples.end(), [](const BookSample& a, const BookSample& b) {
+        return a.key != b.key ? a.key < b.key : a.move < b.move;
+    });
+    std::vector<BookStats> stats;
+    for (const BookSample& sample : samples) {
+        if (stats.empty() || stats.back().key != sample.key || stats.back().move != sample.move) {
+            stats.push_back({sample.key, sample.move, 0, 0});
+        }
+        stats.back().games += 1;
+        stats.back().points += sample.points;
+    }
+
+    stats.erase(std::remove_if(stats.begin(), stats.end(),
+                               [&](const BookStats& entry) {
+                                   return entry.points == 0 ||
+                                          entry.games < static_cast<uint32_t>(options.minGames);
+                               }),
+                stats.end());
+
+    // Weights must fit 16 bits; scale down uniformly if a move is that popular
+    uint32_t maxPoints = 0;
+    for (const BookStats& entry : stats) maxPoints = std::max(maxPoints, entry.points);
+    double scale = (maxPoints > 0xFFFF) ? 65535.0 / maxPoints : 1.0;
+
+    std::vector<BookEntry> entries;
+    entries.reserve(stats.size());
+    for (const BookStats& entry : stats) {
+        uint16_t weight = static_cast<uint16_t>(std::max(1.0, entry.points * scale));
+        entries.push_back({entry.key, entry.move, weight, 0});
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    std::ofstream out(options.outputPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create " + options.outputPath);
+    }
+    if (chess960) Chess960Book::writeHeader(out);
+    for (const BookEntry& entry : entries) {
+        writeBookEntry(out, entry);
+    }
+
+    std::cout << "Wrote " << entries.size() << (chess960 ? " Chess960" : " Polyglot") << " book entries from "
+              << replay.gameCount() << " games to " << options.outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef BOOK_BUILDER_HPP
+#define BOOK_BUILDER_HPP
+
+#include <string>
+
+struct BookBuildOptions {
+    std::string inputPath;   // PGN, e.g. datagen self-play games
+    std::string outputPath;  // Polyglot or Chess960 book
+    int maxPlies = 20;       // Only the first plies of each game go in the book
+    int minGames = 1;        // Moves played fewer times are left out
+};
+
+// Replays every game, counts each (position, move) pair with its result, and
+// writes a sorted book weighted 2 per win and 1 per draw for the mover.
+// Games may start from a FEN tag. Standard games give a Polyglot book; if any
+// game has Chess960 castling, the whole collection goes in a Chess960Book.
+int buildOpeningBook(const BookBuildOptions& options);
+
+#endif  // BOOK_BUILDER_HPP
@@ -0,0 +1,104 @@
+#include "Chess960.hpp"
+
+#include <cctype>
+#include <vector>
+
+void generateChess960Position(int N, std::string& epd) {
+    std::vector<char> positions(8, '1');
+
+    int N1 = N;
+
+    // Step a: Place bishops on opposite colors
+    int B1 = N1 % 4;
+    N1 = N1 / 4;
+    std::vector<int> lightSquares = {1,3,5,7};
+    positions[lightSquares[B1]] = 'B';
+
+    int B2 = N1 % 4;
+    N1 = N1 / 4;
+    std::vector<int> darkSquares = {0,2,4,6};
+    positions[darkSquares[B2]] = 'B';
+
+    // Step b: Place queen
+    std::vector<int> emptySquares;
+    for(int i = 0; i < 8; ++i) {
+        if(positions[i] == '1') emptySquares.push_back(i);
+    }
+    int Q = N1 % 6;
+    N1 = N1 / 6;
+    positions[emptySquares[Q]] = 'Q';
+
+    // Step c: Place knights
+    emptySquares.clear();
+    for(int i = 0; i < 8; ++i) {
+        if(positions[i] == '1') emptySquares.push_back(i);
+    }
+    int N4 = N1 % 10;
+
+    int knight1 = 0, knight2 = 1;  // Every N4 from 0 to 9 is set below
+    switch(N4) {
+        case 0: knight1 = 0; knight2 = 1; break;
+        case 1: knight1 = 0; knight2 = 2; break;
+        case 2: knight1 = 0; knight2 = 3; break;
+        case 3: knight1 = 0; knight2 = 4; break;
+        case 4: knight1 = 1; knight2 = 2; break;
+        case 5: knight1 = 1; knight2 = 3; break;
+        case 6: knight1 = 1; knight2 = 4; break;
+        case 7: knight1 = 2; knight2 = 3; break;
+        case 8: knight1 = 2; knight2 = 4; break;
+        case 9: knight1 = 3; knight2 = 4; break;
+    }
+    positions[emptySquares[knight1]] = 'N';
+    positions[emptySquares[knight2]] = 'N';
+
+    // Step d: Place remaining pieces R K R, with king between rooks
+    emptySquares.clear();
+    for(int i = 0; i < 8; ++i) {
+        if(positions[i] == '1') emptySquares.push_back(i);
+    }
+    // There should be exactly 3 empty squares left
+    positions[emptySquares[0]] = 'R';
+    positions[emptySquares[1]] = 'K';
+    positions[emptySquares[2]] = 'R';
+
+    // Convert positions to EPD string
+    std::string firstRank;
+    for(char c : positions) {
+        firstRank += c;
+    }
+    // Simplify the string by replacing sequences of '1's with numbers
+    std::string simplifiedRank;
+    int emptyCount = 0;
+    for(char c : firstRank) {
+        if(c == '1') {
+            emptyCount++;
+        } else {
+            if(emptyCount > 0) {
+                simplifiedRank += std::to_string(emptyCount);
+                emptyCount = 0;
+            }
+            simplifiedRank += c;
+        }
+    }
+    if(emptyCount > 0) {
+        simplifiedRank += std::to_string(emptyCount);
+    }
+
+    std::string secondRank = "PPPPPPPP";
+    std::string seventhRank = "pppppppp";
+
+    // Black's back rank faces white's on the same files, so it is the same
+    // string in lowercase (FEN lists every rank from the a-file)
+    std::string blackFirstRank = "";
+    for(size_t i = 0; i < simplifiedRank.size(); ++i) {
+        char c = simplifiedRank[i];
+        if(c >= 'A' && c <= 'Z') {
+            blackFirstRank += std::tolower(c);
+        } else {
+            blackFirstRank += c;
+        }
+    }
+
+
+    epd = blackFirstRank + "/pppppppp/8/8/8/8/PPPPPPPP/" + simplifiedRank;
+}
@@ -0,0 +1,10 @@
+#ifndef CHESS960_HPP
+#define CHESS960_HPP
+
+#include <string>
+
+// Writes the piece placement of Chess960 starting position N (0..959, with
+// 518 being the standard setup) into epd
+void generateChess960Position(int N, std::string& epd);
+
+#endif  // CHESS960_HPP
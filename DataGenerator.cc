@@ -0,0 +1,171 @@
+#include "DataGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "BasicEngine.hpp"
+#include "Board.hpp"
+#include "Chess960.hpp"
+#include "Notation.hpp"
+#include "PositionDatabase.hpp"
+#include "RandomEngine.hpp"
+
+// Games still running after this many plies are scored as draws
+static const int MAX_GAME_PLIES = 400;
+
+struct GeneratorOutput {
+    RecordWriter<TrainingRecord> writer;
+    std::ofstream games;  // Open only when PGN output was requested
+    std::mutex mutex;
+    std::atomic<uint64_t> written{0};
+    uint64_t target;
+
+    GeneratorOutput(const DataGenOptions& options) : writer(options.outputPath), target(options.positions) {
+        if (!options.gamesPath.empty()) {
+            games.open(options.gamesPath, std::ios::trunc);
+            if (!games) {
+                throw std::runtime_error("Cannot create " + options.gamesPath);
+            }
+        }
+    }
+};
+
+static bool isCapture(const Board& board, const Move& move) {
+    return move.isEnPassant || (!move.isCastling && board.getPieceAt(move.targetSquare) != -1);
+}
+
+// Plays one game and returns its result from white's point of view, with the
+// quiet positions it passed through left in records and, when sanMoves is
+// given, the moves played appended to it
+static int playGame(Board& board, const DataGenOptions& options, std::vector<TrainingRecord>& records,
+                    std::vector<std::string>* sanMoves) {
+    BasicEngine engine(options.depth);
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply) {
+        if (board.isCheckmate()) {
+            return -board.colorTurn;  // Side to move has been mated
+        }
+        if (board.isDraw()) {
+            return 0;
+        }
+
+        Move bestMove = engine.getBestMove(board);
+        int score = engine.getLastScore();
+        if (std::abs(score) >= BasicEngine::MATE_BOUND) {
+            // Adjudicate a found mate instead of playing it out
+            return (score > 0) ? board.colorTurn : -board.colorTurn;
+        }
+
+        if (!board.isKingInCheck(board.colorTurn) && !isCapture(board, bestMove)) {
+            TrainingRecord record = {};
+            record.position = board.pack();
+            record.score = static_cast<int16_t>(std::clamp(score * board.colorTurn, -32000, 32000));
+            records.push_back(record);
+        }
+        if (sanMoves) sanMoves->push_back(moveToSAN(board, bestMove));
+        board.makeMove(bestMove);
+    }
+    return 0;
+}
+
+static void writeGame(std::ostream& out, const std::string& startFen, const std::vector<std::string>& sanMoves,
+                      int result) {
+    const char* resultText = (result > 0) ? "1-0" : (result < 0) ? "0-1" : "1/2-1/2";
+    out << "[Event \"datagen\"]\n[Variant \"Chess960\"]\n[SetUp \"1\"]\n[FEN \"" << startFen
+        << "\"]\n[Result \"" << resultText << "\"]\n\n";
+    for (size_t i = 0; i < sanMoves.size(); ++i) {
+        if (i % 2 == 0) out << (i / 2 + 1) << ". ";
+        out << sanMoves[i] << ((i % 16 == 15) ? '\n' : ' ');
+    }
+    out << resultText << "\n\n";
+}
+
+static void generatorThread(GeneratorOutput& output, const DataGenOptions& options, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    RandomEngine randomEngine(static_cast<uint32_t>(rng()));
+    std::vector<TrainingRecord> records;
+    std::vector<std::string> sanMoves;
+    std::vector<std::string>* gameMoves = output.games.is_open() ? &sanMoves : nullptr;
+    std::string epd;
+
+    while (output.written < output.target) {
+        generateChess960Position(static_cast<int>(rng() % 960), epd);
+        Board board(epd);
+        std::string startFen = board.toFEN();
+        sanMoves.clear();
+
+        // Random opening; games that end inside it are thrown away
+        bool ended = false;
+        for (int ply = 0; ply < options.randomPlies && !ended; ++ply) {
+            Move move = randomEngine.getBestMove(board);
+            if (gameMoves) gameMoves->push_back(moveToSAN(board, move));
+            board.makeMove(move);
+            ended = board.moves.empty() || board.isDraw();
+        }
+        if (ended) continue;
+
+        records.clear();
+        int result = playGame(board, options, records, gameMoves);
+        for (TrainingRecord& record : records) {
+            record.result = static_cast<int8_t>(result);
+        }
+
+        std::lock_guard<std::mutex> lock(output.mutex);
+        uint64_t written = output.written;
+        if (written >= output.target) break;
+        size_t count = static_cast<size_t>(std::min<uint64_t>(records.size(), output.target - written));
+        output.writer.write(records.data(), count);
+        output.written = written + count;
+        if (gameMoves) writeGame(output.games, startFen, sanMoves, result);
+    }
+}
+
+int runDataGeneration(const DataGenOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t seed = options.seed ? options.seed : std::random_device{}();
+    int threadCount = std::max(1, options.threads);
+    GeneratorOutput output(options);
+
+    std::cout << "Generating " << options.positions << " positions on " << threadCount
+              << " threads at depth " << options.depth << " (seed " << seed << ")" << std::endl;
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        uint64_t threadSeed = seed + 0x9E3779B97F4A7C15ULL * (i + 1);
+        threads.emplace_back(generatorThread, std::ref(output), std::cref(options), threadSeed);
+    }
+
+    // Progress report until every thread has finished
+    auto lastReport = start;
+    while (output.written < output.target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = Clock::now();
+        if (now - lastReport >= std::chrono::seconds(10)) {
+            double hours = std::chrono::duration<double>(now - start).count() / 3600.0;
+            std::cout << output.written << " positions ("
+                      << static_cast<uint64_t>(output.written / hours) << "/hour)" << std::endl;
+            lastReport = now;
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    output.writer.flush();
+    output.games.flush();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Wrote " << output.written << " positions to " << options.outputPath << " in "
+              << static_cast<int>(seconds) << " s ("
+              << static_cast<uint64_t>(output.written / seconds * 3600.0) << "/hour)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef DATA_GENERATOR_HPP
+#define DATA_GENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+
+struct DataGenOptions {
+    std::string outputPath;
+    std::string gamesPath;         // Also write every game as PGN when set
+    uint64_t positions = 1000000;  // Stop once this many records are written
+    int threads = 1;
+    int depth = 3;                 // BasicEngine depth for every game move
+    int randomPlies = 8;           // Random moves played from the Chess960 setup
+    uint64_t seed = 0;             // 0 picks a random seed
+};
+
+// Plays self-play games from randomized Chess960 openings and streams quiet
+// positions (not in check, best move not a capture) labelled with the search
+// score and final game result to a TrainingRecord file. The PGN output feeds
+// the opening book builder.
+int runDataGeneration(const DataGenOptions& options);
+
+#endif  // DATA_GENERATOR_HPP
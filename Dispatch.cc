@@ -0,0 +1,73 @@
+// Launcher installed as `chess` by `make dist`. It runs the fastest build
+// this CPU can execute: chess-avx2, chess-bmi2, chess-popcnt or the
+// baseline chess-x86-64. It looks for them in its own directory and falls
+// back to the next variant when one is missing. Arguments pass through
+// unchanged, so the launcher is a drop-in for the engine. CHESS_VARIANT
+// names a variant to force, for comparing builds on one machine.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Fastest first, each with what the CPU needs to run it
+struct Variant {
+    const char* name;
+    bool (*supported)();
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+static bool hasPopcnt() { return __builtin_cpu_supports("popcnt"); }
+static bool hasBmi2() { return hasPopcnt() && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"); }
+static bool hasAvx2() { return hasBmi2() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+#else
+static bool hasPopcnt() { return false; }
+static bool hasBmi2() { return false; }
+static bool hasAvx2() { return false; }
+#endif
+static bool always() { return true; }
+
+static const Variant VARIANTS[] = {
+    {"avx2", hasAvx2},
+    {"bmi2", hasBmi2},
+    {"popcnt", hasPopcnt},
+    {"x86-64", always},
+};
+
+// Directory of this executable, with a trailing slash
+static std::string ownDirectory(const char* argv0) {
+    std::string path;
+    char buffer[4096];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+    if (length > 0) {
+        path.assign(buffer, static_cast<size_t>(length));
+    } else {
+        path = argv0;
+    }
+    size_t slash = path.rfind('/');
+    return (slash == std::string::npos) ? "./" : path.substr(0, slash + 1);
+}
+
+int main(int argc, char* argv[]) {
+    (void)argc;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+#endif
+    std::string directory = ownDirectory(argv[0]);
+    const char* forced = std::getenv("CHESS_VARIANT");
+
+    std::vector<std::string> tried;
+    for (const Variant& variant : VARIANTS) {
+        if (forced ? std::string(forced) != variant.name : !variant.supported()) continue;
+        std::string path = directory + "chess-" + variant.name;
+        execv(path.c_str(), argv);  // Returns only when the variant cannot be run
+        tried.push_back(path);
+    }
+
+    std::fprintf(stderr, "No engine build found to run; tried:\n");
+    for (const std::string& path : tried) std::fprintf(stderr, "  %s\n", path.c_str());
+    if (tried.empty()) std::fprintf(stderr, "  nothing: unknown CHESS_VARIANT %s\n", forced);
+    return 1;
+}
@@ -1,14 +1,67 @@
 #pragma once
 
 #include "Board.hpp"
+#include "OpeningBook.hpp"
 #include "Piece.hpp"
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <random>
 
 
+// A root move with its score (side to move's view), search depth and
+// principal variation, which starts with the move itself
+struct SearchLine {
+    Move move;
+    int score;
+    int depth;
+    std::vector<Move> pv;
+};
+
 class Engine {
 public:
     virtual ~Engine() = default;
     virtual Move getBestMove(const Board& board) = 0;
-};
 
+    // Up to multiPV best root moves, best first. Engines without a real search
+    // report their single choice.
+    virtual std::vector<SearchLine> analyze(const Board& board, int /*multiPV*/) {
+        if (board.moves.empty()) return {};
+        Move move = getBestMove(board);
+        return {SearchLine{move, 0, 0, {move}}};
+    }
+
+    // Plays a weighted book move while the position is in one of the opening
+    // books, so the opening costs no search time, and searches once out of book.
+    // expectedReply, when given, receives the second move of the principal
+    // variation (or an empty move), which is what pondering searches next.
+    Move chooseMove(const Board& board, Move* expectedReply = nullptr) {
+        Move move;
+        if (expectedReply) *expectedReply = Move();
+        for (const auto& book : openingBooks) {
+            if (book->probe(board, bookRng(), move)) return move;
+        }
+
+        std::vector<SearchLine> lines = analyze(board, 1);
+        if (lines.empty()) return Move();
+        if (expectedReply && lines.front().pv.size() > 1) *expectedReply = lines.front().pv[1];
+        return lines.front().move;
+    }
+
+    // Asks a search running on another thread to return as soon as possible;
+    // its result is then meaningless. The request stays set until clearStop.
+    void stop() { stopRequested = true; }
+    void clearStop() { stopRequested = false; }
+
+    // Books are consulted in the order they were added
+    void addOpeningBook(std::shared_ptr<const OpeningBook> book) {
+        openingBooks.push_back(std::move(book));
+    }
+
+protected:
+    std::atomic<bool> stopRequested{false};
+
+private:
+    std::vector<std::shared_ptr<const OpeningBook>> openingBooks;
+    std::mt19937 bookRng{std::random_device{}()};
+};
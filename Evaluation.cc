@@ -0,0 +1,33 @@
+#include "Evaluation.hpp"
+
+#include "TunedWeights.hpp"
+
+const EvalWeights& defaultEvalWeights() {
+    return TUNED_WEIGHTS;
+}
+
+int evaluatePosition(const Board& board, const EvalWeights& weights) {
+    int score = 0;
+    for (int i = 0; i < 12; ++i) {
+        int baseType = i % 6;
+        const int* table = weights.pieceSquare[baseType];
+        uint64_t pieces = board.bitboards[i];
+        int pieceCount = __builtin_popcountll(pieces);
+
+        int placement = 0;
+        if (i < 6) {
+            while (pieces) {
+                placement += table[__builtin_ctzll(pieces)];
+                pieces &= pieces - 1;
+            }
+            score += weights.material[baseType] * pieceCount + placement;
+        } else {
+            while (pieces) {
+                placement += table[__builtin_ctzll(pieces) ^ 56];  // Mirror to white's side
+                pieces &= pieces - 1;
+            }
+            score -= weights.material[baseType] * pieceCount + placement;
+        }
+    }
+    return score;
+}
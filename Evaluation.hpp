@@ -0,0 +1,20 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include "Board.hpp"
+
+// Linear evaluation weights. A piece of base type t on square s contributes
+// material[t] + pieceSquare[t][s] for white; black pieces use the square
+// mirrored to white's side and count negatively.
+struct EvalWeights {
+    int material[6];          // Indexed by BasePieceType
+    int pieceSquare[6][64];
+};
+
+// Weights compiled in from TunedWeights.hpp, which ./chess tune regenerates
+const EvalWeights& defaultEvalWeights();
+
+// Score in centipawns from white's point of view
+int evaluatePosition(const Board& board, const EvalWeights& weights);
+
+#endif  // EVALUATION_HPP
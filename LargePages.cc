@@ -0,0 +1,101 @@
+#include "LargePages.hpp"
+
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t roundUp(size_t bytes, size_t multiple) {
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+static void* mapAnonymous(size_t bytes, int extraFlags) {
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return (mapping == MAP_FAILED) ? nullptr : mapping;
+}
+
+LargePageBuffer::LargePageBuffer(size_t bytes, bool hugePages) : length(bytes) {
+    if (bytes == 0) return;
+
+#ifdef MAP_HUGETLB
+    // Reserved huge pages only exist where the administrator set some aside
+    if (hugePages) {
+        mappedLength = roundUp(bytes, HUGE_PAGE_SIZE);
+        memory = mapAnonymous(mappedLength, MAP_HUGETLB);
+        if (memory) {
+            kind = PageKind::Explicit;
+            return;
+        }
+    }
+#endif
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages need 2 MB aligned ranges, so map one huge page
+    // extra and trim the ends
+    if (hugePages) {
+        mappedLength = roundUp(bytes, HUGE_PAGE_SIZE);
+        char* mapping = static_cast<char*>(mapAnonymous(mappedLength + HUGE_PAGE_SIZE, 0));
+        if (mapping) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(mapping);
+            size_t head = roundUp(address, HUGE_PAGE_SIZE) - address;
+            if (head > 0) munmap(mapping, head);
+            if (HUGE_PAGE_SIZE - head > 0) munmap(mapping + head + mappedLength, HUGE_PAGE_SIZE - head);
+            memory = mapping + head;
+            kind = (madvise(memory, mappedLength, MADV_HUGEPAGE) == 0) ? PageKind::Transparent : PageKind::Normal;
+            return;
+        }
+    }
+#endif
+
+    mappedLength = bytes;
+    memory = mapAnonymous(mappedLength, 0);
+    if (!memory) {
+        throw std::runtime_error("Cannot allocate " + std::to_string(bytes >> 20) + " MB");
+    }
+    kind = PageKind::Normal;
+}
+
+LargePageBuffer::~LargePageBuffer() {
+    release();
+}
+
+LargePageBuffer::LargePageBuffer(LargePageBuffer&& other) noexcept
+    : memory(other.memory), length(other.length), mappedLength(other.mappedLength), kind(other.kind) {
+    other.memory = nullptr;
+    other.length = 0;
+    other.mappedLength = 0;
+}
+
+LargePageBuffer& LargePageBuffer::operator=(LargePageBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        memory = other.memory;
+        length = other.length;
+        mappedLength = other.mappedLength;
+        kind = other.kind;
+        other.memory = nullptr;
+        other.length = 0;
+        other.mappedLength = 0;
+    }
+    return *this;
+}
+
+void LargePageBuffer::release() {
+    if (memory) {
+        munmap(memory, mappedLength);
+        memory = nullptr;
+        length = 0;
+        mappedLength = 0;
+    }
+}
+
+const char* pageKindName(PageKind kind) {
+    switch (kind) {
+        case PageKind::Explicit: return "huge pages";
+        case PageKind::Transparent: return "transparent huge pages";
+        default: return "normal pages";
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef LARGE_PAGES_HPP
+#define LARGE_PAGES_HPP
+
+#include <cstddef>
+
+// How a large allocation ended up backed
+enum class PageKind {
+    Normal,       // Ordinary 4 KB pages
+    Transparent,  // 2 MB aligned and advised for transparent huge pages
+    Explicit      // Reserved huge pages (MAP_HUGETLB)
+};
+
+// Zeroed, 64-byte aligned memory for big tables such as the transposition
+// table. With hugePages set, reserved huge pages are tried first, then a
+// 2 MB aligned mapping advised for transparent huge pages, so each TLB entry
+// covers 2 MB of table instead of 4 KB. Falls back to ordinary pages, and
+// throws std::runtime_error only when no memory can be had at all.
+class LargePageBuffer {
+public:
+    LargePageBuffer() = default;
+    LargePageBuffer(size_t bytes, bool hugePages);
+    ~LargePageBuffer();
+
+    LargePageBuffer(const LargePageBuffer&) = delete;
+    LargePageBuffer& operator=(const LargePageBuffer&) = delete;
+    LargePageBuffer(LargePageBuffer&& other) noexcept;
+    LargePageBuffer& operator=(LargePageBuffer&& other) noexcept;
+
+    void* data() const { return memory; }
+    size_t size() const { return length; }
+    PageKind pageKind() const { return kind; }
+
+private:
+    void* memory = nullptr;
+    size_t length = 0;
+    size_t mappedLength = 0;  // Rounded up to whole pages
+    PageKind kind = PageKind::Normal;
+
+    void release();
+};
+
+const char* pageKindName(PageKind kind);
+
+#endif  // LARGE_PAGES_HPP
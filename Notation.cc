@@ -0,0 +1,188 @@
+#include "Notation.hpp"
+
+static const char PIECE_LETTERS[] = "KQBNRP";
+
+static int baseType(int pieceIndex) {
+    return pieceIndex % 6;
+}
+
+static bool isCastlingKingside(const Move& move) {
+    return move.targetSquare > move.startSquare;
+}
+
+std::string moveToSAN(const Board& board, const Move& move) {
+    std::string san;
+    int piece = board.getPieceAt(move.startSquare);
+    int type = baseType(piece);
+
+    if (move.isCastling) {
+        san = isCastlingKingside(move) ? "O-O" : "O-O-O";
+    } else {
+        bool capture = move.isEnPassant || board.getPieceAt(move.targetSquare) != -1;
+        if (type == BasePieceType::Pawn) {
+            if (capture) {
+                san += static_cast<char>('a' + move.startSquare % 8);
+            }
+        } else {
+            san += PIECE_LETTERS[type];
+
+            // Disambiguate against other pieces of the same kind reaching the square
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (const Move& other : board.moves) {
+                if (other.targetSquare != move.targetSquare || other.startSquare == move.startSquare ||
+                    other.isCastling || board.getPieceAt(other.startSquare) != piece) {
+                    continue;
+                }
+                ambiguous = true;
+                sameFile |= other.startSquare % 8 == move.startSquare % 8;
+                sameRank |= other.startSquare / 8 == move.startSquare / 8;
+            }
+            if (ambiguous) {
+                if (!sameFile) {
+                    san += static_cast<char>('a' + move.startSquare % 8);
+                } else if (!sameRank) {
+                    san += static_cast<char>('1' + move.startSquare / 8);
+                } else {
+                    san += static_cast<char>('a' + move.startSquare % 8);
+                    san += static_cast<char>('1' + move.startSquare / 8);
+                }
+            }
+        }
+
+        if (capture) san += 'x';
+        san += static_cast<char>('a' + move.targetSquare % 8);
+        san += static_cast<char>('1' + move.targetSquare / 8);
+
+        if (move.promotionPiece != 0) {
+            san += '=';
+            san += PIECE_LETTERS[baseType(move.promotionPiece)];
+        }
+    }
+
+    Board after = board;
+    after.makeMove(move);
+    if (after.isKingInCheck(after.colorTurn)) {
+        san += after.moves.empty() ? '#' : '+';
+    }
+    return san;
+}
+
+bool parseSAN(const Board& board, std::string_view san, Move& move) {
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.remove_suffix(1);
+    }
+    if (san.empty()) return false;
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool kingside = san.size() == 3;
+        for (const Move& candidate : board.moves) {
+            if (candidate.isCastling && isCastlingKingside(candidate) == kingside) {
+                move = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // [piece][from file][from rank][x]<to square>[=promotion]
+    int type = BasePieceType::Pawn;
+    if (san.front() >= 'A' && san.front() <= 'Z') {
+        const char* letter = std::char_traits<char>::find(PIECE_LETTERS, 5, san.front());
+        if (!letter) return false;
+        type = static_cast<int>(letter - PIECE_LETTERS);
+        san.remove_prefix(1);
+    }
+
+    int promotion = -1;
+    size_t equals = san.find('=');
+    if (equals != std::string_view::npos || (san.size() >= 3 && san.back() >= 'A' && san.back() <= 'Z')) {
+        char letter = san.back();
+        const char* found = std::char_traits<char>::find(PIECE_LETTERS + 1, 4, letter);
+        if (!found) return false;
+        promotion = static_cast<int>(found - PIECE_LETTERS);
+        san.remove_suffix(equals != std::string_view::npos ? san.size() - equals : 1);
+    }
+
+    if (san.size() < 2) return false;
+    char targetFile = san[san.size() - 2];
+    char targetRank = san[san.size() - 1];
+    if (targetFile < 'a' || targetFile > 'h' || targetRank < '1' || targetRank > '8') return false;
+    int targetSquare = (targetRank - '1') * 8 + (targetFile - 'a');
+    san.remove_suffix(2);
+
+    int fromFile = -1;
+    int fromRank = -1;
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') {
+            fromFile = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            fromRank = c - '1';
+        } else if (c != 'x' && c != '-') {
+            return false;
+        }
+    }
+
+    int matches = 0;
+    for (const Move& candidate : board.moves) {
+        if (candidate.isCastling || candidate.targetSquare != targetSquare) continue;
+        if (baseType(board.getPieceAt(candidate.startSquare)) != type) continue;
+        if (fromFile != -1 && candidate.startSquare % 8 != fromFile) continue;
+        if (fromRank != -1 && candidate.startSquare / 8 != fromRank) continue;
+        int candidatePromotion = candidate.promotionPiece ? baseType(candidate.promotionPiece) : -1;
+        if (candidatePromotion != promotion) continue;
+
+        move = candidate;
+        ++matches;
+    }
+    return matches == 1;
+}
+
+static void appendSquare(std::string& text, int square) {
+    text += static_cast<char>('a' + square % 8);
+    text += static_cast<char>('1' + square / 8);
+}
+
+std::string moveToUCI(const Move& move, bool chess960) {
+    std::string text;
+    if (move.startSquare < 0) return "0000";  // Null move
+
+    appendSquare(text, move.startSquare);
+    appendSquare(text, (move.isCastling && !chess960) ? Board::castlingKingTarget(move) : move.targetSquare);
+    if (move.promotionPiece != 0) {
+        text += static_cast<char>(PIECE_LETTERS[baseType(move.promotionPiece)] - 'A' + 'a');
+    }
+    return text;
+}
+
+bool parseUCIMove(const Board& board, std::string_view text, Move& move) {
+    if (text.size() < 4 || text.size() > 5) return false;
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8' ||
+        text[2] < 'a' || text[2] > 'h' || text[3] < '1' || text[3] > '8') {
+        return false;
+    }
+    int startSquare = (text[1] - '1') * 8 + (text[0] - 'a');
+    int targetSquare = (text[3] - '1') * 8 + (text[2] - 'a');
+    int promotion = -1;
+    if (text.size() == 5) {
+        const char* found = std::char_traits<char>::find(PIECE_LETTERS + 1, 4, text[4] - 'a' + 'A');
+        if (!found) return false;
+        promotion = static_cast<int>(found - PIECE_LETTERS);
+    }
+
+    // An exact target wins: in Chess960 a king step can share its square with
+    // the destination of a castling move
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const Move& candidate : board.moves) {
+            if (candidate.startSquare != startSquare) continue;
+            int candidateTarget = (pass == 0) ? candidate.targetSquare
+                                  : candidate.isCastling ? Board::castlingKingTarget(candidate)
+                                                         : -1;
+            int candidatePromotion = candidate.promotionPiece ? baseType(candidate.promotionPiece) : -1;
+            if (candidateTarget == targetSquare && candidatePromotion == promotion) {
+                move = candidate;
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+#ifndef NOTATION_HPP
+#define NOTATION_HPP
+
+#include <string>
+#include <string_view>
+
+#include "Board.hpp"
+
+// Standard algebraic notation for a legal move, with check and mate suffixes.
+// Castling is written O-O / O-O-O whatever the Chess960 setup.
+std::string moveToSAN(const Board& board, const Move& move);
+
+// Finds the legal move a SAN token refers to. Accepts the usual variations
+// (0-0, missing or extra capture marks, trailing +#!?). Returns false when
+// the token matches no legal move or more than one.
+bool parseSAN(const Board& board, std::string_view san, Move& move);
+
+// UCI long algebraic notation (e2e4, e7e8q). Castling is written as the king's
+// two-square move, or king-takes-rook when chess960 is set (UCI_Chess960).
+std::string moveToUCI(const Move& move, bool chess960);
+
+// Finds the legal move a UCI move string refers to; either castling form is
+// accepted
+bool parseUCIMove(const Board& board, std::string_view text, Move& move);
+
+#endif  // NOTATION_HPP
@@ -0,0 +1,172 @@
+#include "Numa.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef USE_NUMA
+#include <numa.h>
+#endif
+
+NumaPolicy parseNumaPolicy(const std::string& name) {
+    if (name == "auto") return NumaPolicy::Auto;
+    if (name == "none") return NumaPolicy::None;
+    if (name == "bind") return NumaPolicy::Bind;
+    throw std::runtime_error("Unknown NUMA policy " + name);
+}
+
+const char* numaPolicyName(NumaPolicy policy) {
+    switch (policy) {
+        case NumaPolicy::None: return "none";
+        case NumaPolicy::Bind: return "bind";
+        default: return "auto";
+    }
+}
+
+// CPUs the process is allowed on; every CPU when that cannot be asked
+static std::vector<bool> allowedCpus() {
+    std::vector<bool> allowed;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                allowed.resize(cpu + 1);
+                allowed[cpu] = true;
+            }
+        }
+    }
+#endif
+    return allowed;
+}
+
+// Parses a kernel CPU list such as "0-15,32-47"
+static std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+NumaTopology::NumaTopology() {
+    std::vector<bool> allowed = allowedCpus();
+    auto isAllowed = [&allowed](int cpu) {
+        return allowed.empty() || (cpu < static_cast<int>(allowed.size()) && allowed[cpu]);
+    };
+
+#ifdef USE_NUMA
+    if (numa_available() != -1) {
+        struct bitmask* mask = numa_allocate_cpumask();
+        for (int node = 0; node <= numa_max_node(); ++node) {
+            std::vector<int> cpus;
+            if (numa_node_to_cpus(node, mask) == 0) {
+                for (unsigned cpu = 0; cpu < mask->size; ++cpu) {
+                    if (numa_bitmask_isbitset(mask, cpu) && isAllowed(cpu)) cpus.push_back(cpu);
+                }
+            }
+            if (!cpus.empty()) nodeCpus.push_back(cpus);
+        }
+        numa_free_cpumask(mask);
+        if (!nodeCpus.empty()) source = "libnuma";
+    }
+#endif
+
+    if (nodeCpus.empty()) {
+        for (int node = 0;; ++node) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!list) break;
+            std::string text;
+            std::getline(list, text);
+            std::vector<int> cpus;
+            for (int cpu : parseCpuList(text)) {
+                if (isAllowed(cpu)) cpus.push_back(cpu);
+            }
+            if (!cpus.empty()) nodeCpus.push_back(cpus);
+        }
+        if (!nodeCpus.empty()) source = "sysfs";
+    }
+
+    if (nodeCpus.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < static_cast<int>(allowed.size()); ++cpu) {
+            if (allowed[cpu]) cpus.push_back(cpu);
+        }
+        nodeCpus.push_back(cpus);
+        source = "single node";
+    }
+}
+
+const NumaTopology& NumaTopology::system() {
+    static const NumaTopology topology;
+    return topology;
+}
+
+bool NumaTopology::binds(NumaPolicy policy) const {
+    return policy == NumaPolicy::Bind || (policy == NumaPolicy::Auto && nodeCount() > 1);
+}
+
+int NumaTopology::bindThread(int index, NumaPolicy policy) const {
+    if (!binds(policy)) return -1;
+
+    int node = index % nodeCount();
+    const std::vector<int>& cpus = nodeCpus[node];
+    if (cpus.empty()) return node;  // CPUs unknown; nothing to pin to
+    int cpu = cpus[(index / nodeCount()) % cpus.size()];
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);  // Best effort; an unpinned worker still works
+#endif
+#ifdef USE_NUMA
+    if (numa_available() != -1) numa_set_localalloc();
+#endif
+    return node;
+}
+
+void NumaTopology::interleave(void* memory, size_t bytes, NumaPolicy policy) const {
+#ifdef USE_NUMA
+    if (binds(policy) && nodeCount() > 1 && numa_available() != -1) {
+        numa_interleave_memory(memory, bytes, numa_all_nodes_ptr);
+    }
+#else
+    (void)memory;
+    (void)bytes;
+    (void)policy;
+#endif
+}
+
+// Compresses a CPU list back into ranges
+static std::string formatCpuList(const std::vector<int>& cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t end = i;
+        while (end + 1 < cpus.size() && cpus[end + 1] == cpus[end] + 1) ++end;
+        if (!text.empty()) text += ',';
+        text += std::to_string(cpus[i]);
+        if (end > i) text += '-' + std::to_string(cpus[end]);
+        i = end + 1;
+    }
+    return text;
+}
+
+std::string NumaTopology::describe() const {
+    std::string text = std::to_string(nodeCount()) + (nodeCount() == 1 ? " node (" : " nodes (") + source + "):";
+    for (int node = 0; node < nodeCount(); ++node) {
+        text += (node == 0 ? " " : " | ") + formatCpuList(nodeCpus[node]);
+    }
+    return text;
+}
@@ -0,0 +1,52 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Where worker threads and their memory go on multi-socket machines
+enum class NumaPolicy {
+    Auto,  // Bind when the machine has more than one node
+    None,  // Leave threads and memory to the OS
+    Bind   // Pin each worker to a core, spreading workers evenly over the nodes
+};
+
+// Parses "auto", "none" or "bind"
+NumaPolicy parseNumaPolicy(const std::string& name);
+const char* numaPolicyName(NumaPolicy policy);
+
+// The machine's NUMA nodes and the CPUs of each that this process may run
+// on. Read through libnuma when built with it (make NUMA=1), otherwise from
+// /sys/devices/system/node; without either it is one node holding every
+// allowed CPU, and binding only pins threads.
+class NumaTopology {
+public:
+    static const NumaTopology& system();
+
+    int nodeCount() const { return static_cast<int>(nodeCpus.size()); }
+    bool binds(NumaPolicy policy) const;
+
+    // Pins the calling thread, the index-th worker, to one CPU. Workers go
+    // to the nodes in turn, so each node gets an equal share. Memory the
+    // thread touches first afterwards (its engine, boards and own table) is
+    // then allocated on its node. Returns the node, or -1 when the policy
+    // leaves threads alone.
+    int bindThread(int index, NumaPolicy policy) const;
+
+    // Spreads the pages of a table shared by every worker evenly over the
+    // nodes, so no one socket serves all the probes. Needs libnuma; a no-op
+    // otherwise. Call before the memory is first touched.
+    void interleave(void* memory, size_t bytes, NumaPolicy policy) const;
+
+    // For example "2 nodes (libnuma): 0-15,32-47 | 16-31,48-63"
+    std::string describe() const;
+
+private:
+    NumaTopology();
+
+    std::vector<std::vector<int>> nodeCpus;
+    const char* source = "single node";
+};
+
+#endif  // NUMA_HPP
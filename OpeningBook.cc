@@ -0,0 +1,251 @@
+#include "OpeningBook.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+#include "PackedPosition.hpp"
+#include "PolyglotRandom.hpp"
+
+static const size_t ENTRY_SIZE = 16;
+
+static const char* const STANDARD_START = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Chess960 book header. The reserved bytes start with the engine's key for the
+// standard start position, which changes with any change to its Zobrist keys.
+static constexpr char CHESS960_BOOK_MAGIC[8] = {'C', '9', '6', '0', 'B', 'O', 'K', '\0'};
+static const uint32_t CHESS960_BOOK_VERSION = 1;
+
+// Polyglot piece kind of each PieceType: black pawn 0, white pawn 1, black
+// knight 2, ... white king 11
+static const int POLYGLOT_KIND[12] = {11, 9, 5, 3, 7, 1, 10, 8, 4, 2, 6, 0};
+
+// The standard start position's key worked out from the table, checked
+// against the key published with the format
+constexpr uint64_t polyglotStartKey() {
+    constexpr int whiteBackRank[8] = {7, 3, 5, 9, 11, 5, 3, 7};  // RNBQKBNR
+    uint64_t key = POLYGLOT_RANDOM[POLYGLOT_TURN_OFFSET];
+    for (int file = 0; file < 8; ++file) {
+        key ^= POLYGLOT_RANDOM[POLYGLOT_PIECE_OFFSET + 64 * whiteBackRank[file] + file];
+        key ^= POLYGLOT_RANDOM[POLYGLOT_PIECE_OFFSET + 64 * (whiteBackRank[file] - 1) + 56 + file];
+        key ^= POLYGLOT_RANDOM[POLYGLOT_PIECE_OFFSET + 64 * 1 + 8 + file];
+        key ^= POLYGLOT_RANDOM[POLYGLOT_PIECE_OFFSET + 64 * 0 + 48 + file];
+    }
+    for (int right = 0; right < 4; ++right) {
+        key ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING_OFFSET + right];
+    }
+    return key;
+}
+
+static_assert(polyglotStartKey() == 0x463B96181691FC9C, "Polyglot Random64 table does not give the published start key");
+
+uint64_t polyglotKey(const Board& board) {
+    uint64_t key = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        for (uint64_t bits = board.bitboards[piece]; bits; bits &= bits - 1) {
+            key ^= POLYGLOT_RANDOM[POLYGLOT_PIECE_OFFSET + 64 * POLYGLOT_KIND[piece] + __builtin_ctzll(bits)];
+        }
+    }
+
+    // CastlingRight is in Polyglot's KQkq order
+    for (int right = 0; right < 4; ++right) {
+        if (board.castlingRooks[right] != -1) key ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING_OFFSET + right];
+    }
+
+    if (board.enPassantTarget != -1) {
+        int file = board.enPassantTarget % 8;
+        int pawnSquare = board.enPassantTarget - 8 * board.colorTurn;  // The pawn that moved two squares
+        uint64_t beside = 0;
+        if (file > 0) beside |= 1ULL << (pawnSquare - 1);
+        if (file < 7) beside |= 1ULL << (pawnSquare + 1);
+        int ownPawn = (board.colorTurn == 1) ? PieceType::WhitePawn : PieceType::BlackPawn;
+        if (board.bitboards[ownPawn] & beside) key ^= POLYGLOT_RANDOM[POLYGLOT_EN_PASSANT_OFFSET + file];
+    }
+
+    if (board.colorTurn == 1) key ^= POLYGLOT_RANDOM[POLYGLOT_TURN_OFFSET];
+    return key;
+}
+
+bool hasStandardCastling(const Board& board) {
+    static const int rookSquares[4] = {7, 0, 63, 56};
+    static const int kingSquares[4] = {4, 4, 60, 60};
+    for (int right = 0; right < 4; ++right) {
+        if (board.castlingRooks[right] == -1) continue;
+        int king = (right < BlackKingside) ? PieceType::WhiteKing : PieceType::BlackKing;
+        if (board.castlingRooks[right] != rookSquares[right] ||
+            !(board.bitboards[king] & (1ULL << kingSquares[right]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t engineStartKey() {
+    return Board(STANDARD_START).computeHash();
+}
+
+static uint64_t readBigEndian(const unsigned char* bytes, int length) {
+    uint64_t value = 0;
+    for (int i = 0; i < length; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static void writeBigEndian(std::ostream& out, uint64_t value, int length) {
+    char bytes[8];
+    for (int i = length - 1; i >= 0; --i) {
+        bytes[i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+    out.write(bytes, length);
+}
+
+// Polyglot promotion codes: 1 knight, 2 bishop, 3 rook, 4 queen
+static int promotionCode(int promotionPiece) {
+    switch (promotionPiece % 6) {
+        case BasePieceType::Knight: return 1;
+        case BasePieceType::Bishop: return 2;
+        case BasePieceType::Rook: return 3;
+        case BasePieceType::Queen: return 4;
+        default: return 0;
+    }
+}
+
+uint16_t encodeBookMove(const Move& move) {
+    int promotion = move.promotionPiece ? promotionCode(move.promotionPiece) : 0;
+    return static_cast<uint16_t>(move.targetSquare | (move.startSquare << 6) | (promotion << 12));
+}
+
+void writeBookEntry(std::ostream& out, const BookEntry& entry) {
+    writeBigEndian(out, entry.key, 8);
+    writeBigEndian(out, entry.move, 2);
+    writeBigEndian(out, entry.weight, 2);
+    writeBigEndian(out, entry.learn, 4);
+}
+
+OpeningBook::OpeningBook(const std::string& path) : OpeningBook(path, 0) {
+    if (file.size() >= sizeof(CHESS960_BOOK_MAGIC) &&
+        std::memcmp(file.data(), CHESS960_BOOK_MAGIC, sizeof(CHESS960_BOOK_MAGIC)) == 0) {
+        throw std::runtime_error("Chess960 book, not a Polyglot book: " + path);
+    }
+}
+
+OpeningBook::OpeningBook(const std::string& path, size_t headerSize) : file(path) {
+    if (file.size() < headerSize || (file.size() - headerSize) % ENTRY_SIZE != 0) {
+        throw std::runtime_error("Not an opening book: " + path);
+    }
+    entries = file.data() + headerSize;
+    count = (file.size() - headerSize) / ENTRY_SIZE;
+}
+
+bool OpeningBook::keyFor(const Board& board, uint64_t& key) const {
+    if (!hasStandardCastling(board)) return false;
+    key = polyglotKey(board);
+    return true;
+}
+
+BookEntry OpeningBook::entryAt(size_t index) const {
+    const unsigned char* bytes = entries + index * ENTRY_SIZE;
+    BookEntry entry;
+    entry.key = readBigEndian(bytes, 8);
+    entry.move = static_cast<uint16_t>(readBigEndian(bytes + 8, 2));
+    entry.weight = static_cast<uint16_t>(readBigEndian(bytes + 10, 2));
+    entry.learn = static_cast<uint32_t>(readBigEndian(bytes + 12, 4));
+    return entry;
+}
+
+std::vector<std::pair<Move, int>> OpeningBook::lookup(const Board& board) const {
+    std::vector<std::pair<Move, int>> result;
+    uint64_t key;
+    if (!keyFor(board, key)) return result;
+
+    // Lower bound on the sorted keys
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (readBigEndian(entries + middle * ENTRY_SIZE, 8) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (size_t i = low; i < count; ++i) {
+        BookEntry entry = entryAt(i);
+        if (entry.key != key) break;
+        if (entry.weight == 0) continue;
+
+        // Only trust entries that decode to a legal move here
+        for (const Move& move : board.moves) {
+            if (encodeBookMove(move) == entry.move) {
+                result.emplace_back(move, entry.weight);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+bool OpeningBook::probe(const Board& board, uint32_t random, Move& move) const {
+    std::vector<std::pair<Move, int>> candidates = lookup(board);
+    if (candidates.empty()) return false;
+
+    uint64_t totalWeight = 0;
+    for (const auto& candidate : candidates) {
+        totalWeight += candidate.second;
+    }
+
+    uint64_t pick = random % totalWeight;
+    for (const auto& candidate : candidates) {
+        if (pick < static_cast<uint64_t>(candidate.second)) {
+            move = candidate.first;
+            return true;
+        }
+        pick -= candidate.second;
+    }
+    move = candidates.back().first;
+    return true;
+}
+
+Chess960Book::Chess960Book(const std::string& path) : OpeningBook(path, sizeof(PackedFileHeader)) {
+    PackedFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CHESS960_BOOK_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CHESS960_BOOK_VERSION || header.recordSize != ENTRY_SIZE) {
+        throw std::runtime_error("Not a Chess960 book: " + path);
+    }
+    uint64_t startKey;
+    std::memcpy(&startKey, header.reserved, sizeof(startKey));
+    if (startKey != engineStartKey()) {
+        throw std::runtime_error("Chess960 book built with other position keys; rebuild it: " + path);
+    }
+}
+
+void Chess960Book::writeHeader(std::ostream& out) {
+    PackedFileHeader header = {};
+    std::memcpy(header.magic, CHESS960_BOOK_MAGIC, sizeof(header.magic));
+    header.version = CHESS960_BOOK_VERSION;
+    header.recordSize = ENTRY_SIZE;
+    uint64_t startKey = engineStartKey();
+    std::memcpy(header.reserved, &startKey, sizeof(startKey));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool Chess960Book::isChess960Book(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(CHESS960_BOOK_MAGIC)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, CHESS960_BOOK_MAGIC, sizeof(magic)) == 0;
+}
+
+bool Chess960Book::keyFor(const Board& board, uint64_t& key) const {
+    key = board.computeHash();
+    return true;
+}
+
+std::shared_ptr<const OpeningBook> openOpeningBook(const std::string& path) {
+    if (Chess960Book::isChess960Book(path)) return std::make_shared<const Chess960Book>(path);
+    return std::make_shared<const OpeningBook>(path);
+}
@@ -0,0 +1,99 @@
+#ifndef OPENING_BOOK_HPP
+#define OPENING_BOOK_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Board.hpp"
+#include "MappedFile.hpp"
+
+// One 16-byte Polyglot book entry. On disk every field is big-endian and the
+// file is sorted by key.
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;    // to file:3, to rank:3, from file:3, from rank:3, promotion:3
+    uint16_t weight;  // Relative probability of playing the move
+    uint32_t learn;
+};
+
+// Polyglot key of a position: the XOR of the Random64 entries for its pieces,
+// castling rights, en passant file (only when a pawn of the side to move
+// stands next to the pawn that just moved two squares) and side to move.
+// Keys every Polyglot book, so it must agree with other tools bit for bit.
+uint64_t polyglotKey(const Board& board);
+
+// Whether Polyglot keys describe the position: every castling right still
+// held is for a king and rook on their standard start squares
+bool hasStandardCastling(const Board& board);
+
+// Memory-mapped opening book in Polyglot file layout, keyed by polyglotKey,
+// so books built by other Polyglot tools work too. Lookups binary-search the
+// mapped entries, so a book of any size opens instantly and costs no heap.
+// Chess960 positions other than the standard setup are never found.
+class OpeningBook {
+public:
+    explicit OpeningBook(const std::string& path);
+    virtual ~OpeningBook() = default;
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    size_t size() const { return count; }
+
+    // Legal book moves for the position with their weights, in book order
+    std::vector<std::pair<Move, int>> lookup(const Board& board) const;
+
+    // Picks a book move with probability proportional to its weight; random is
+    // any uniformly distributed value. Returns false when out of book.
+    bool probe(const Board& board, uint32_t random, Move& move) const;
+
+protected:
+    // Maps path with its entries starting headerSize bytes in
+    OpeningBook(const std::string& path, size_t headerSize);
+
+    // Key the book is sorted by, or false when the book cannot hold the
+    // position
+    virtual bool keyFor(const Board& board, uint64_t& key) const;
+
+    MappedFile file;
+
+private:
+    const unsigned char* entries = nullptr;
+    size_t count = 0;
+
+    BookEntry entryAt(size_t index) const;
+};
+
+// Book for Chess960 games, keyed by the engine's own Zobrist hashes
+// (Board::computeHash), which tell apart every starting setup and castling
+// rook, so one book holds openings for all 960 start positions. Its own file
+// format: a PackedFileHeader recording the engine's key layout, then Polyglot
+// layout entries. A book whose keys no longer match the engine's is refused
+// rather than silently never hitting.
+class Chess960Book : public OpeningBook {
+public:
+    explicit Chess960Book(const std::string& path);
+
+    // Writes the header for a book keyed by the running engine
+    static void writeHeader(std::ostream& out);
+
+    // Whether the file starts with a Chess960 book header
+    static bool isChess960Book(const std::string& path);
+
+protected:
+    bool keyFor(const Board& board, uint64_t& key) const override;
+};
+
+// Opens a Polyglot or Chess960 book, telling them apart by the header
+std::shared_ptr<const OpeningBook> openOpeningBook(const std::string& path);
+
+// Polyglot move encoding. Castling is encoded king-to-rook, the same way Move
+// stores it.
+uint16_t encodeBookMove(const Move& move);
+
+// Appends an entry to a book file in big-endian layout
+void writeBookEntry(std::ostream& out, const BookEntry& entry);
+
+#endif  // OPENING_BOOK_HPP
@@ -0,0 +1,57 @@
+#ifndef PACKED_POSITION_HPP
+#define PACKED_POSITION_HPP
+
+#include <cstdint>
+
+// 32-byte binary position. Pieces are stored one nibble each, in ascending
+// square order of the occupancy bitboard. Nibble values are PieceType indexes,
+// except that a rook which still carries a castling right is stored as
+// CastlingRookWhite/CastlingRookBlack, so Chess960 rook files need no extra
+// space. Multi-byte fields are in host byte order (little-endian on every
+// platform we build for).
+struct PackedPosition {
+    static constexpr char FileMagic[8] = {'C', '9', '6', '0', 'P', 'O', 'S', '\0'};
+    static constexpr uint32_t FileVersion = 1;
+
+    static constexpr uint8_t CastlingRookWhite = 12;
+    static constexpr uint8_t CastlingRookBlack = 13;
+    static constexpr uint8_t NoEnPassant = 64;
+
+    uint64_t occupancy;
+    uint8_t pieces[16];
+    uint8_t sideToMove;      // 0 white, 1 black
+    uint8_t enPassant;       // Target square, or NoEnPassant
+    uint8_t halfMoveClock;   // Saturates at 255
+    uint8_t reserved;
+    uint16_t fullMoveNumber;
+    uint8_t padding[2];
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// A position labelled by the data generator: search score and final game
+// result, both from white's point of view
+struct TrainingRecord {
+    static constexpr char FileMagic[8] = {'C', '9', '6', '0', 'T', 'R', 'N', '\0'};
+    static constexpr uint32_t FileVersion = 1;
+
+    PackedPosition position;
+    int16_t score;   // Centipawns
+    int8_t result;   // 1 white won, 0 draw, -1 black won
+    uint8_t padding[5];
+};
+
+static_assert(sizeof(TrainingRecord) == 40, "TrainingRecord must stay 40 bytes");
+
+// Header at the start of every record file; records follow directly. The
+// magic and version identify the record type.
+struct PackedFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(PackedFileHeader) == 32, "PackedFileHeader must stay 32 bytes");
+
+#endif  // PACKED_POSITION_HPP
@@ -0,0 +1,152 @@
+#include "PerfCounters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct CounterEvent {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+#ifdef __linux__
+constexpr uint64_t cacheReadMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Report order; the names are also what report() looks ratios up by
+const CounterEvent COUNTER_EVENTS[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1D misses", PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D)},
+    {"LLC misses", PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL)},
+    {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"CPU time (ns)", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int openCounter(const CounterEvent& event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    attr.inherit = 1;  // Threads the region starts count towards it
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+std::string openError(int error) {
+    switch (error) {
+        case ENOENT:
+        case EOPNOTSUPP: return "not counted by this CPU or virtual machine";
+        case EACCES:
+        case EPERM: return "not permitted; see /proc/sys/kernel/perf_event_paranoid";
+        default: return std::strerror(error);
+    }
+}
+#else
+const CounterEvent COUNTER_EVENTS[] = {
+    {"cycles", 0, 0}, {"instructions", 0, 0}, {"L1D misses", 0, 0}, {"LLC misses", 0, 0},
+    {"branch misses", 0, 0}, {"CPU time (ns)", 0, 0}, {"page faults", 0, 0},
+};
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+    for (const CounterEvent& event : COUNTER_EVENTS) {
+        Counter counter;
+        counter.name = event.name;
+#ifdef __linux__
+        counter.fd = openCounter(event);
+        if (counter.fd == -1) counter.error = openError(errno);
+#else
+        counter.error = "needs Linux";
+#endif
+        counters.push_back(counter);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const Counter& counter : counters) {
+        if (counter.fd != -1) close(counter.fd);
+    }
+#endif
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (Counter& counter : counters) {
+        if (counter.fd == -1) continue;
+        ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounters::stop() {
+#ifdef __linux__
+    for (Counter& counter : counters) {
+        if (counter.fd == -1) continue;
+        ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        // Value, time enabled, time running; when more counters were asked for
+        // than the CPU has, each ran part of the time and is scaled up
+        uint64_t data[3] = {0, 0, 0};
+        if (read(counter.fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            counter.error = "unreadable";
+            continue;
+        }
+        counter.scaled = data[2] > 0 && data[2] < data[1];
+        counter.value = (data[2] > 0) ? static_cast<double>(data[0]) * data[1] / data[2] : 0;
+    }
+#endif
+}
+
+const PerfCounters::Counter* PerfCounters::find(const char* name) const {
+    for (const Counter& counter : counters) {
+        if (std::strcmp(counter.name, name) == 0 && counter.error.empty()) return &counter;
+    }
+    return nullptr;
+}
+
+void PerfCounters::report(std::ostream& out, uint64_t nodes) const {
+    double perNode = 1.0 / static_cast<double>(nodes == 0 ? 1 : nodes);
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "Counters per node" << std::endl;
+    for (const Counter& counter : counters) {
+        out << "  " << std::left << std::setw(14) << counter.name << std::right << ": ";
+        if (!counter.error.empty()) {
+            out << "unavailable (" << counter.error << ")" << std::endl;
+            continue;
+        }
+        out << counter.value * perNode;
+        if (std::strcmp(counter.name, "instructions") == 0) {
+            const Counter* cycles = find("cycles");
+            if (cycles && cycles->value > 0) out << " (IPC " << counter.value / cycles->value << ")";
+        }
+        if (counter.scaled) out << " (multiplexed)";
+        out << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,48 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Hardware event counts (cycles, instructions, L1 data and last-level cache
+// misses, branch misses) over a measured region, read with perf_event_open.
+// Threads started inside the region are counted too, so a multithreaded
+// perft is measured whole. Counts are for user space only, which an
+// unprivileged process may read at perf_event_paranoid 2.
+//
+// Counters the CPU, the kernel or a virtual machine does not provide are
+// reported as unavailable rather than failing; off Linux they all are. CPU
+// time and page faults come from the kernel and are available almost
+// everywhere.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Zeroes and starts every counter
+    void start();
+    void stop();
+
+    // One line per counter, divided by the nodes of the region, e.g.
+    //   instructions  : 1523.400 (IPC 2.910)
+    void report(std::ostream& out, uint64_t nodes) const;
+
+private:
+    struct Counter {
+        const char* name;
+        int fd = -1;
+        std::string error;   // Why the counter could not be opened
+        double value = 0;    // Scaled up when the kernel multiplexed it
+        bool scaled = false;
+    };
+    std::vector<Counter> counters;
+
+    const Counter* find(const char* name) const;
+};
+
+#endif  // PERF_COUNTERS_HPP
@@ -0,0 +1,535 @@
+#include "Perft.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "Chess960.hpp"
+#include "Notation.hpp"
+#include "PerfCounters.hpp"
+
+uint64_t perft(const Board& board, int depth) {
+    if (depth <= 1) {
+        return depth == 1 ? board.moves.size() : 1;  // Bulk count the last ply
+    }
+
+    uint64_t nodes = 0;
+    for (const Move& move : board.moves) {
+        Board child = board;
+        child.makeMove(move);
+        nodes += perft(child, depth - 1);
+    }
+    return nodes;
+}
+
+namespace {
+
+// Lock-free cache of subtree counts. Each slot holds the count and depth in one
+// word and that word XORed with the position key in the other, so a slot torn
+// by two concurrent writers fails the key check instead of returning a wrong
+// count.
+class PerftHashTable {
+public:
+    explicit PerftHashTable(size_t entries) {
+        size_t size = 1;
+        while (size * 2 <= entries) size *= 2;
+        slots = std::make_unique<Slot[]>(size);
+        mask = size - 1;
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Slot& slot = slots[key & mask];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || static_cast<int>(data & 0xFF) != depth) return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes) {
+        Slot& slot = slots[key & mask];
+        uint64_t data = (nodes << 8) | static_cast<uint64_t>(depth);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+};
+
+struct PerftTask {
+    Board board;
+    int depth;
+    std::atomic<uint64_t>* result;  // Counter of the root move the task belongs to
+};
+
+class PerftScheduler {
+public:
+    PerftScheduler(int threads, int splitDepth, PerftHashTable* table)
+        : threadCount(std::max(1, threads)),
+          splitDepth(std::max(2, splitDepth)),
+          table(table),
+          queues(std::make_unique<WorkerQueue[]>(threadCount)) {}
+
+    // Spreads the tasks over the workers and runs until every task, including
+    // the ones split off on the way, has finished
+    void run(std::vector<PerftTask>& tasks) {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            push(static_cast<int>(i % threadCount), std::move(tasks[i]));
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threadCount; ++i) {
+            workers.emplace_back(&PerftScheduler::workerLoop, this, i);
+        }
+        workerLoop(0);
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+    }
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<PerftTask> tasks;
+    };
+
+    const int threadCount;
+    const int splitDepth;
+    PerftHashTable* table;
+    std::unique_ptr<WorkerQueue[]> queues;
+    std::atomic<int64_t> pendingTasks{0};
+    std::atomic<int> idleWorkers{0};
+
+    void push(int worker, PerftTask task) {
+        pendingTasks.fetch_add(1);
+        std::lock_guard<std::mutex> lock(queues[worker].mutex);
+        queues[worker].tasks.push_back(std::move(task));
+    }
+
+    // Newest own task first, so a worker stays in the subtree it just split
+    std::optional<PerftTask> pop(int worker) {
+        std::lock_guard<std::mutex> lock(queues[worker].mutex);
+        if (queues[worker].tasks.empty()) return std::nullopt;
+        std::optional<PerftTask> task(std::move(queues[worker].tasks.back()));
+        queues[worker].tasks.pop_back();
+        return task;
+    }
+
+    // Oldest task of another worker, which is the shallowest and so the largest
+    std::optional<PerftTask> steal(int worker) {
+        for (int offset = 1; offset < threadCount; ++offset) {
+            WorkerQueue& victim = queues[(worker + offset) % threadCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            std::optional<PerftTask> task(std::move(victim.tasks.front()));
+            victim.tasks.pop_front();
+            return task;
+        }
+        return std::nullopt;
+    }
+
+    void workerLoop(int worker) {
+        while (pendingTasks.load() > 0) {
+            std::optional<PerftTask> task = pop(worker);
+            if (!task) task = steal(worker);
+            if (task) {
+                bool split = false;
+                uint64_t nodes = count(worker, task->board, task->depth, task->result, split);
+                task->result->fetch_add(nodes, std::memory_order_relaxed);
+                pendingTasks.fetch_sub(1);
+            } else {
+                idleWorkers.fetch_add(1);
+                std::this_thread::yield();
+                idleWorkers.fetch_sub(1);
+            }
+        }
+    }
+
+    // Counts a subtree. While another worker is idle, a deep enough node is
+    // handed out as one task per move instead, which report to the same result
+    // counter; the split node itself then contributes nothing here. split is
+    // set when this or any node below was split, and such a partial count is
+    // not stored in the table.
+    uint64_t count(int worker, const Board& board, int depth, std::atomic<uint64_t>* result, bool& split) {
+        if (depth <= 1) {
+            return depth == 1 ? board.moves.size() : 1;
+        }
+
+        uint64_t key = 0;
+        uint64_t nodes = 0;
+        if (table) {
+            key = board.computeHash();
+            if (table->probe(key, depth, nodes)) return nodes;
+        }
+
+        if (depth >= splitDepth && board.moves.size() > 1 &&
+            idleWorkers.load(std::memory_order_relaxed) > 0) {
+            for (const Move& move : board.moves) {
+                Board child = board;
+                child.makeMove(move);
+                push(worker, PerftTask{std::move(child), depth - 1, result});
+            }
+            split = true;
+            return 0;
+        }
+
+        for (const Move& move : board.moves) {
+            Board child = board;
+            child.makeMove(move);
+            nodes += count(worker, child, depth - 1, result, split);
+        }
+        if (table && !split) table->store(key, depth, nodes);
+        return nodes;
+    }
+};
+
+}  // namespace
+
+std::vector<PerftDivide> perftDivide(const Board& board, int depth, const PerftOptions& options) {
+    if (depth < 1) {
+        throw std::runtime_error("Perft depth must be at least 1");
+    }
+
+    std::unique_ptr<PerftHashTable> table;
+    if (options.hashEntries > 0) {
+        table = std::make_unique<PerftHashTable>(options.hashEntries);
+    }
+
+    const size_t moveCount = board.moves.size();
+    auto results = std::make_unique<std::atomic<uint64_t>[]>(moveCount);
+    std::vector<PerftTask> tasks;
+    for (size_t i = 0; i < moveCount; ++i) {
+        results[i] = 0;
+        Board child = board;
+        child.makeMove(board.moves[i]);
+        tasks.push_back(PerftTask{std::move(child), depth - 1, &results[i]});
+    }
+
+    PerftScheduler scheduler(options.threads, options.splitDepth, table.get());
+    scheduler.run(tasks);
+
+    std::vector<PerftDivide> divide;
+    for (size_t i = 0; i < moveCount; ++i) {
+        divide.push_back(PerftDivide{board.moves[i], results[i].load()});
+    }
+    return divide;
+}
+
+int runPerft(const std::string& fen, int depth, const PerftOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    Board board(fen);
+    std::unique_ptr<PerfCounters> counters;
+    if (options.counters) counters = std::make_unique<PerfCounters>();
+
+    if (counters) counters->start();
+    auto start = Clock::now();
+    std::vector<PerftDivide> divide = perftDivide(board, depth, options);
+    if (counters) counters->stop();
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+    if (elapsedMs == 0) elapsedMs = 1;
+
+    uint64_t total = 0;
+    for (const PerftDivide& entry : divide) {
+        std::cout << moveToUCI(entry.move, options.chess960) << ": " << entry.nodes << '\n';
+        total += entry.nodes;
+    }
+    std::cout << "===========================" << std::endl;
+    std::cout << "Total time (ms) : " << elapsedMs << std::endl;
+    std::cout << "Nodes searched  : " << total << std::endl;
+    std::cout << "Nodes/second    : " << total * 1000 / elapsedMs << std::endl;
+    if (counters) counters->report(std::cout, total);
+    return 0;
+}
+
+static constexpr int CHESS960_POSITIONS = 960;
+
+// Reads "<fen> ;D1 n ;D2 n ..." lines; counts[d - 1] is the perft at depth d
+static std::vector<std::vector<uint64_t>> loadSweepReference(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+
+    std::vector<std::vector<uint64_t>> reference;
+    std::string line;
+    std::string epd;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        const int index = static_cast<int>(reference.size());
+        if (index >= CHESS960_POSITIONS) {
+            throw std::runtime_error(path + " has more than 960 positions");
+        }
+        generateChess960Position(index, epd);
+        if (line.compare(0, line.find(' '), epd) != 0) {
+            throw std::runtime_error(path + " line for position " + std::to_string(index) +
+                                     " is not " + epd);
+        }
+
+        std::vector<uint64_t> counts;
+        for (size_t field = line.find(";D"); field != std::string::npos; field = line.find(";D", field + 2)) {
+            size_t depth = std::stoul(line.substr(field + 2));
+            size_t value = line.find(' ', field);
+            if (depth != counts.size() + 1 || value == std::string::npos) {
+                throw std::runtime_error("Bad perft field in " + path + ": " + line);
+            }
+            counts.push_back(std::stoull(line.substr(value + 1)));
+        }
+        reference.push_back(std::move(counts));
+    }
+    return reference;
+}
+
+int runChess960Sweep(const Chess960SweepOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    if (options.depth < 1) {
+        throw std::runtime_error("Perft depth must be at least 1");
+    }
+    std::vector<std::vector<uint64_t>> reference;
+    if (!options.referencePath.empty()) {
+        reference = loadSweepReference(options.referencePath);
+    }
+
+    // Every depth up to the target is counted, so a mismatch can be reported at
+    // the shallowest depth where it shows up
+    std::vector<std::vector<uint64_t>> counts(CHESS960_POSITIONS);
+    std::atomic<int> nextPosition{0};
+    std::unique_ptr<PerfCounters> counters;
+    if (options.counters) counters = std::make_unique<PerfCounters>();
+
+    if (counters) counters->start();
+    auto start = Clock::now();
+
+    auto worker = [&]() {
+        std::string epd;
+        for (int index = nextPosition++; index < CHESS960_POSITIONS; index = nextPosition++) {
+            generateChess960Position(index, epd);
+            Board board(epd);
+            for (int depth = 1; depth <= options.depth; ++depth) {
+                counts[index].push_back(perft(board, depth));
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < std::max(1, options.threads); ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (counters) counters->stop();
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+    if (elapsedMs == 0) elapsedMs = 1;
+
+    uint64_t totalNodes = 0;
+    int checked = 0;
+    int mismatches = 0;
+    std::string epd;
+    for (int index = 0; index < CHESS960_POSITIONS; ++index) {
+        for (uint64_t nodes : counts[index]) totalNodes += nodes;
+        if (static_cast<size_t>(index) >= reference.size()) continue;
+
+        const std::vector<uint64_t>& expected = reference[index];
+        size_t depths = std::min(expected.size(), counts[index].size());
+        if (depths > 0) checked++;
+        for (size_t d = 0; d < depths; ++d) {
+            if (counts[index][d] == expected[d]) continue;
+
+            generateChess960Position(index, epd);
+            Board board(epd);
+            std::cout << "Position " << index << " (" << board.toFEN(true) << ") depth " << (d + 1)
+                      << ": expected " << expected[d] << ", got " << counts[index][d] << '\n';
+            PerftOptions divideOptions;
+            divideOptions.threads = options.threads;
+            for (const PerftDivide& entry : perftDivide(board, static_cast<int>(d + 1), divideOptions)) {
+                std::cout << "  " << moveToUCI(entry.move, true) << ": " << entry.nodes << '\n';
+            }
+            mismatches++;
+            break;
+        }
+    }
+
+    if (!options.outputPath.empty()) {
+        std::ofstream out(options.outputPath, std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create " + options.outputPath);
+        }
+        for (int index = 0; index < CHESS960_POSITIONS; ++index) {
+            generateChess960Position(index, epd);
+            out << Board(epd).toFEN();
+            for (size_t d = 0; d < counts[index].size(); ++d) {
+                out << " ;D" << (d + 1) << ' ' << counts[index][d];
+            }
+            out << '\n';
+        }
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Positions       : " << CHESS960_POSITIONS << " to depth " << options.depth << std::endl;
+    std::cout << "Checked         : " << checked << std::endl;
+    std::cout << "Mismatches      : " << mismatches << std::endl;
+    std::cout << "Total time (ms) : " << elapsedMs << std::endl;
+    std::cout << "Nodes searched  : " << totalNodes << std::endl;
+    std::cout << "Nodes/second    : " << totalNodes * 1000 / elapsedMs << std::endl;
+    if (counters) counters->report(std::cout, totalNodes);
+    return mismatches > 0 ? 1 : 0;
+}
+
+// The standard perft positions, then small ones where the check comes from
+// castling, en passant or a promotion
+static const char* const MOVE_CHECK_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9",
+    "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+    "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    "3k4/8/8/8/8/8/8/1RK5 w B - 0 1",
+    "8/8/8/k2pP2R/8/8/8/4K3 w - d6 0 1",
+    "1k6/1b6/8/8/3Pp3/8/8/7K b - d3 0 1",
+    "4k3/1P6/8/8/8/8/6p1/4K3 w - - 0 1",
+};
+
+namespace {
+
+// Identifies a move, so generator outputs can be compared as sets
+uint32_t moveIdentity(const Move& move) {
+    return static_cast<uint32_t>(move.startSquare) | (static_cast<uint32_t>(move.targetSquare) << 6) |
+           (static_cast<uint32_t>(move.promotionPiece) << 12) | (static_cast<uint32_t>(move.isEnPassant) << 16) |
+           (static_cast<uint32_t>(move.isCastling) << 17);
+}
+
+std::vector<uint32_t> sortedIdentities(const std::vector<Move>& moves) {
+    std::vector<uint32_t> identities;
+    for (const Move& move : moves) identities.push_back(moveIdentity(move));
+    std::sort(identities.begin(), identities.end());
+    return identities;
+}
+
+class MoveGenChecker {
+public:
+    uint64_t nodes = 0;
+    uint64_t moves = 0;
+    uint64_t mismatches = 0;
+    uint64_t exchanges = 0;
+
+    void check(Board& board, int depth) {
+        ++nodes;
+        const std::vector<uint32_t> legal = sortedIdentities(board.moves);
+
+        // Captures and quiets split the legal moves between them
+        board.generateLegalMoves(GenerateCaptures, captures);
+        board.generateLegalMoves(GenerateQuiets, quiets);
+        const std::vector<uint32_t> quietIdentities = sortedIdentities(quiets);
+        std::vector<Move> both = captures;
+        both.insert(both.end(), quiets.begin(), quiets.end());
+        if (sortedIdentities(both) != legal) report(board, "captures and quiets are not the legal moves");
+        if (board.isKingInCheck(board.colorTurn)) {
+            board.generateLegalMoves(GenerateEvasions, evasions);
+            if (sortedIdentities(evasions) != legal) report(board, "evasions are not the legal moves");
+        }
+
+        std::vector<Move> expectedQuietChecks;
+        for (const Move& move : board.moves) {
+            ++moves;
+            Board child = board;
+            child.makeMove(move);
+            bool checks = child.isKingInCheck(child.colorTurn);
+            if (board.givesCheck(move) != checks) {
+                report(board, "givesCheck " + moveToUCI(move, true) + " should be " + (checks ? "true" : "false"));
+            }
+            if (checks && std::binary_search(quietIdentities.begin(), quietIdentities.end(), moveIdentity(move))) {
+                expectedQuietChecks.push_back(move);
+            }
+            checkExchange(board, move);
+            if (depth > 1) check(child, depth - 1);
+        }
+
+        board.generateQuietChecks(quietChecks);
+        if (sortedIdentities(quietChecks) != sortedIdentities(expectedQuietChecks)) {
+            report(board, "generateQuietChecks differs from the checking quiet moves");
+        }
+    }
+
+private:
+    static constexpr uint64_t MAX_REPORTED = 20;
+    static constexpr int SEE_THRESHOLDS[] = {-20000, -900, -500, -330, -100, -1, 0, 1, 100, 330, 500, 900, 20000};
+
+    // Scratch lists; each is used up before the recursion reuses it
+    std::vector<Move> captures;
+    std::vector<Move> quiets;
+    std::vector<Move> evasions;
+    std::vector<Move> quietChecks;
+
+    // seeGE must answer see() >= threshold, including either side of the
+    // exact exchange value
+    void checkExchange(const Board& board, const Move& move) {
+        const int exchange = board.see(move);
+        auto checkThreshold = [&](int threshold) {
+            ++exchanges;
+            if (board.seeGE(move, threshold) != (exchange >= threshold)) {
+                report(board, "seeGE " + moveToUCI(move, true) + " " + std::to_string(threshold) +
+                                  " disagrees with see " + std::to_string(exchange));
+            }
+        };
+        for (int threshold : SEE_THRESHOLDS) checkThreshold(threshold);
+        checkThreshold(exchange);
+        checkThreshold(exchange + 1);
+    }
+
+    void report(const Board& board, const std::string& what) {
+        if (++mismatches <= MAX_REPORTED) std::cout << board.toFEN(true) << ": " << what << '\n';
+    }
+};
+
+}  // namespace
+
+int runMoveGenCheck(int depth) {
+    using Clock = std::chrono::steady_clock;
+
+    if (depth < 1) {
+        throw std::runtime_error("Move check depth must be at least 1");
+    }
+
+    auto start = Clock::now();
+    MoveGenChecker checker;
+    for (const char* fen : MOVE_CHECK_POSITIONS) {
+        Board board(fen);
+        checker.check(board, depth);
+    }
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Positions       : " << std::size(MOVE_CHECK_POSITIONS) << " to depth " << depth << std::endl;
+    std::cout << "Nodes checked   : " << checker.nodes << std::endl;
+    std::cout << "Moves checked   : " << checker.moves << std::endl;
+    std::cout << "SEE thresholds  : " << checker.exchanges << std::endl;
+    std::cout << "Mismatches      : " << checker.mismatches << std::endl;
+    std::cout << "Total time (ms) : " << elapsedMs << std::endl;
+    return checker.mismatches == 0 ? 0 : 1;
+}
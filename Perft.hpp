@@ -0,0 +1,58 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Board.hpp"
+
+struct PerftOptions {
+    int threads = 1;
+    size_t hashEntries = 0;  // Cache of subtree counts shared by all threads; 0 disables it
+    int splitDepth = 4;      // Subtrees at least this deep are split when a thread is idle
+    bool chess960 = false;   // Print castling moves as king takes rook
+    bool counters = false;   // Report hardware performance counters per node
+};
+
+struct PerftDivide {
+    Move move;
+    uint64_t nodes;
+};
+
+// Number of leaves of the legal move tree below a position, single-threaded
+uint64_t perft(const Board& board, int depth);
+
+// Leaf counts below each root move, in the board's move order. The root moves
+// become tasks on a work-stealing pool; a thread that runs dry steals the
+// oldest (largest) task from another, and busy threads split deep subtrees
+// into further tasks while anyone is idle.
+std::vector<PerftDivide> perftDivide(const Board& board, int depth, const PerftOptions& options);
+
+// Prints the divide, total and speed for a position
+int runPerft(const std::string& fen, int depth, const PerftOptions& options);
+
+struct Chess960SweepOptions {
+    int depth = 4;
+    int threads = 1;
+    std::string referencePath;  // EPD lines "<fen> ;D1 n ;D2 n ..." in position order
+    std::string outputPath;     // Write the computed counts in the same format
+    bool counters = false;      // Report hardware performance counters per node
+};
+
+// Runs perft from every Chess960 starting position 0..959, spread over the
+// threads, and checks each count against the reference table when one is
+// given. Mismatching positions are printed with their divide. Returns 1 if
+// any position disagrees.
+int runChess960Sweep(const Chess960SweepOptions& options);
+
+// Walks the move tree of the standard perft positions, and of positions where
+// castling, en passant and promotions give check, to the given depth. At every
+// node the capture, quiet and evasion generators must together give the legal
+// moves, and givesCheck and generateQuietChecks must agree with making each
+// move and testing the opponent's king, and seeGE must agree with see at a
+// range of thresholds. Mismatches are printed; returns 1 if there are any.
+int runMoveGenCheck(int depth);
+
+#endif  // PERFT_HPP
@@ -0,0 +1,36 @@
+#include "Ponderer.hpp"
+
+void Ponderer::start(Engine& searchEngine, const Board& board, const Move& expectedReply) {
+    cancel();
+    if (expectedReply.startSquare < 0) return;  // Book move or no reply predicted
+
+    Board position = board;
+    position.makeMove(expectedReply);
+    if (position.moves.empty()) return;  // Nothing to search after the reply
+
+    engine = &searchEngine;
+    ponderKey = position.computeHash();
+    lines.clear();
+    thread = std::thread([this, position]() { lines = engine->analyze(position, 1); });
+}
+
+bool Ponderer::ponderHit(const Board& board, SearchLine& line) {
+    if (!isPondering()) return false;
+    if (board.computeHash() != ponderKey) {
+        cancel();
+        return false;
+    }
+
+    thread.join();  // Let the search finish rather than restarting it
+    if (lines.empty()) return false;
+    line = lines.front();
+    return true;
+}
+
+void Ponderer::cancel() {
+    if (!thread.joinable()) return;
+    engine->stop();
+    thread.join();
+    engine->clearStop();
+    lines.clear();
+}
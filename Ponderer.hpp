@@ -0,0 +1,43 @@
+#ifndef PONDERER_HPP
+#define PONDERER_HPP
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "Board.hpp"
+#include "Engine.hpp"
+
+// Searches the position after the opponent's expected reply on a background
+// thread while the opponent thinks. If the reply is played the finished (or
+// still running) search is used as is instead of starting over; otherwise it
+// is stopped and the engine searches normally.
+class Ponderer {
+public:
+    Ponderer() = default;
+    ~Ponderer() { cancel(); }
+
+    Ponderer(const Ponderer&) = delete;
+    Ponderer& operator=(const Ponderer&) = delete;
+
+    // Starts pondering on the position reached by playing expectedReply in
+    // board. The engine must not be used elsewhere until ponderHit or cancel.
+    void start(Engine& engine, const Board& board, const Move& expectedReply);
+
+    // When board is the pondered position, waits for the ponder search and
+    // hands back its best line. Otherwise cancels it and returns false.
+    bool ponderHit(const Board& board, SearchLine& line);
+
+    // Stops and discards any ponder search
+    void cancel();
+
+    bool isPondering() const { return thread.joinable(); }
+
+private:
+    std::thread thread;
+    Engine* engine = nullptr;
+    uint64_t ponderKey = 0;
+    std::vector<SearchLine> lines;
+};
+
+#endif  // PONDERER_HPP
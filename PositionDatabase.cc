@@ -0,0 +1,67 @@
+#include "PositionDatabase.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#include "Board.hpp"
+
+int convertEPDToPacked(const std::string& inputPath, const std::string& outputPath) {
+    using Clock = std::chrono::steady_clock;
+
+    std::ifstream in(inputPath);
+    if (!in) {
+        std::cerr << "Cannot open " << inputPath << std::endl;
+        return 1;
+    }
+
+    auto start = Clock::now();
+    PositionWriter writer(outputPath);
+    Board board("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    std::string line;
+    size_t skipped = 0;
+
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        try {
+            board.loadFEN(line, false);
+            writer.write(board.pack());
+        } catch (const std::exception& e) {
+            std::cerr << "Skipping \"" << line << "\": " << e.what() << std::endl;
+            skipped++;
+        }
+    }
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+    std::cout << "Packed " << writer.written() << " positions (" << skipped
+              << " skipped) in " << elapsedMs << " ms" << std::endl;
+    return 0;
+}
+
+int convertPackedToEPD(const std::string& inputPath, const std::string& outputPath) {
+    using Clock = std::chrono::steady_clock;
+
+    std::ofstream out(outputPath, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Cannot create " << outputPath << std::endl;
+        return 1;
+    }
+
+    auto start = Clock::now();
+    PositionDatabase database(inputPath);
+    Board board("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    char buffer[FEN_BUFFER_SIZE];
+
+    for (const PackedPosition& position : database) {
+        board.loadPacked(position, false);
+        size_t length = board.writeFEN(buffer);
+        buffer[length++] = '\n';
+        out.write(buffer, length);
+    }
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start).count();
+    std::cout << "Unpacked " << database.size() << " positions in " << elapsedMs
+              << " ms" << std::endl;
+    return 0;
+}
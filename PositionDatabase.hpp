@@ -0,0 +1,89 @@
+#ifndef POSITION_DATABASE_HPP
+#define POSITION_DATABASE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "MappedFile.hpp"
+#include "PackedPosition.hpp"
+
+// Memory-mapped, read-only view of a record file (PackedPosition,
+// TrainingRecord). Records are used in place, so iterating a file of any size
+// costs no parsing or copying.
+template <typename Record>
+class RecordDatabase {
+public:
+    explicit RecordDatabase(const std::string& path) : file(path) {
+        const auto* header = reinterpret_cast<const PackedFileHeader*>(file.data());
+        if (file.size() < sizeof(PackedFileHeader) ||
+            std::memcmp(header->magic, Record::FileMagic, sizeof(header->magic)) != 0 ||
+            header->version != Record::FileVersion || header->recordSize != sizeof(Record)) {
+            throw std::runtime_error("Unexpected record file format: " + path);
+        }
+
+        records = reinterpret_cast<const Record*>(file.data() + sizeof(PackedFileHeader));
+        count = (file.size() - sizeof(PackedFileHeader)) / sizeof(Record);
+        file.adviseSequential();
+    }
+
+    const Record* begin() const { return records; }
+    const Record* end() const { return records + count; }
+    const Record& operator[](size_t index) const { return records[index]; }
+    size_t size() const { return count; }
+
+private:
+    MappedFile file;
+    const Record* records = nullptr;
+    size_t count = 0;
+};
+
+// Streams records to a new file, writing the header first
+template <typename Record>
+class RecordWriter {
+public:
+    explicit RecordWriter(const std::string& path)
+        : out(path, std::ios::binary | std::ios::trunc) {
+        if (!out) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+
+        PackedFileHeader header = {};
+        std::memcpy(header.magic, Record::FileMagic, sizeof(header.magic));
+        header.version = Record::FileVersion;
+        header.recordSize = sizeof(Record);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void write(const Record* records, size_t recordCount) {
+        out.write(reinterpret_cast<const char*>(records), recordCount * sizeof(Record));
+        count += recordCount;
+    }
+    void write(const Record& record) { write(&record, 1); }
+    void flush() { out.flush(); }
+    size_t written() const { return count; }
+
+    // Flushes and closes the file. False if any write or the close failed,
+    // as on a full disk, leaving the file incomplete.
+    bool close() {
+        out.flush();
+        bool complete = out.good();
+        out.close();
+        return complete && !out.fail();
+    }
+
+private:
+    std::ofstream out;
+    size_t count = 0;
+};
+
+using PositionDatabase = RecordDatabase<PackedPosition>;
+using PositionWriter = RecordWriter<PackedPosition>;
+
+// ./chess pack <in.epd> <out.bin> and ./chess unpack <in.bin> <out.epd>
+int convertEPDToPacked(const std::string& inputPath, const std::string& outputPath);
+int convertPackedToEPD(const std::string& inputPath, const std::string& outputPath);
+
+#endif  // POSITION_DATABASE_HPP
@@ -9,6 +9,7 @@ private:
 
 public:
     RandomEngine() : rng(std::random_device{}()) {}
+    explicit RandomEngine(uint32_t seed) : rng(seed) {}
 
     Move getBestMove(const Board& board) override {
         if (board.moves.empty()) {
@@ -0,0 +1,281 @@
+#include "SearchCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "PositionDatabase.hpp"
+
+// Longest principal variation kept in a snapshot
+static const int MAX_STORED_PV = 12;
+
+struct TTRecord {
+    static constexpr char FileMagic[8] = {'C', '9', '6', '0', 'T', 'T', '\0', '\0'};
+    static constexpr uint32_t FileVersion = 2;  // 2: mate scores counted from the entry's position
+
+    uint64_t key;
+    int32_t score;
+    int8_t depth;
+    int8_t flag;
+    uint16_t move;
+};
+
+static_assert(sizeof(TTRecord) == 16, "TTRecord must stay 16 bytes");
+
+// One line of a cached analysis; a result is its lines in multiPV order
+struct AnalysisRecord {
+    static constexpr char FileMagic[8] = {'C', '9', '6', '0', 'A', 'N', 'L', '\0'};
+    static constexpr uint32_t FileVersion = 2;  // 2: mate scores as MATE_SCORE less plies to mate
+
+    uint64_t key;
+    int32_t score;
+    int16_t depth;
+    uint8_t lineIndex;
+    uint8_t pvLength;
+    uint16_t pv[MAX_STORED_PV];
+};
+
+static_assert(sizeof(AnalysisRecord) == 40, "AnalysisRecord must stay 40 bytes");
+
+// from:6, to:6, promotion PieceType:4; the legal move list supplies the rest
+static uint16_t encodeMove(const Move& move) {
+    if (move.startSquare < 0) return 0;
+    return static_cast<uint16_t>(move.startSquare | (move.targetSquare << 6) | (move.promotionPiece << 12));
+}
+
+static Move decodeMove(uint16_t code) {
+    if (code == 0) return Move();
+    return Move(code & 63, (code >> 6) & 63, false, code >> 12);
+}
+
+// score:32, depth:8, flag + 2:8 (never zero, so a used slot is never all
+// zero), move:16
+static uint64_t packEntry(const TTEntry& entry) {
+    return static_cast<uint32_t>(entry.score) | (static_cast<uint64_t>(static_cast<uint8_t>(entry.depth)) << 32) |
+           (static_cast<uint64_t>(entry.flag + 2) << 40) | (static_cast<uint64_t>(encodeMove(entry.bestMove)) << 48);
+}
+
+static TTEntry unpackEntry(uint64_t data) {
+    return TTEntry{static_cast<int8_t>(data >> 32), static_cast<int32_t>(data), static_cast<int>((data >> 40) & 0xFF) - 2,
+                   decodeMove(static_cast<uint16_t>(data >> 48))};
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    const Cluster& cluster = clusters[clusterIndex(key)];
+    for (const Slot& slot : cluster.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if (data != 0 && (slot.check.load(std::memory_order_relaxed) ^ data) == key) {
+            entry = unpackEntry(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry& entry) {
+    Cluster& cluster = clusters[clusterIndex(key)];
+    Slot* target = &cluster.slots[0];
+    int targetDepth = std::numeric_limits<int>::max();
+    for (Slot& slot : cluster.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if (data == 0 || (slot.check.load(std::memory_order_relaxed) ^ data) == key) {
+            target = &slot;
+            break;
+        }
+        int depth = static_cast<int8_t>(data >> 32);
+        if (depth < targetDepth) {
+            target = &slot;
+            targetDepth = depth;
+        }
+    }
+
+    uint64_t data = packEntry(entry);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+    target->data.store(data, std::memory_order_relaxed);
+    if (!dirty.load(std::memory_order_relaxed)) dirty.store(true, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    // A search usually starts by clearing a table nothing was stored in yet
+    if (!dirty.load(std::memory_order_relaxed)) return;
+    std::memset(static_cast<void*>(clusters), 0, clusterCount * sizeof(Cluster));
+    dirty.store(false, std::memory_order_relaxed);
+}
+
+size_t TranspositionTable::size() const {
+    size_t used = 0;
+    for (size_t i = 0; i < clusterCount; ++i) {
+        for (const Slot& slot : clusters[i].slots) {
+            if (slot.data.load(std::memory_order_relaxed) != 0) ++used;
+        }
+    }
+    return used;
+}
+
+void TranspositionTable::resize(size_t megabytes, bool hugePages) {
+    clusterCount = std::max<size_t>(1, (megabytes << 20) / sizeof(Cluster));
+    hugePagesAllowed = hugePages;
+    memory = LargePageBuffer(clusterCount * sizeof(Cluster), hugePages);  // Zeroed, so every slot is empty
+    clusters = static_cast<Cluster*>(memory.data());
+    dirty.store(false, std::memory_order_relaxed);
+}
+
+void TranspositionTable::setCapacity(size_t entries) {
+    size_t bytes = (entries + CLUSTER_SIZE - 1) / CLUSTER_SIZE * sizeof(Cluster);
+    resize(entries == 0 ? DEFAULT_MEGABYTES : std::max<size_t>(1, bytes >> 20), hugePagesAllowed);
+}
+
+void TranspositionTable::interleave(NumaPolicy policy) {
+    NumaTopology::system().interleave(memory.data(), memory.size(), policy);
+}
+
+// The legal move in board matching an encoded move
+static bool resolveMove(const Board& board, uint16_t code, Move& move) {
+    for (const Move& candidate : board.moves) {
+        if (encodeMove(candidate) == code) {
+            move = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AnalysisCache::lookup(const Board& board, int depth, int multiPV, std::vector<SearchLine>& lines) const {
+    std::vector<CachedLine> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = results.find(board.computeHash());
+        if (it == results.end()) return false;
+        cached = it->second;
+    }
+
+    if (cached.empty() || cached.front().depth < depth || static_cast<int>(cached.size()) < multiPV) {
+        return false;
+    }
+
+    lines.clear();
+    for (int i = 0; i < multiPV; ++i) {
+        SearchLine line{Move(), cached[i].score, cached[i].depth, {}};
+        Board position = board;
+        for (uint16_t code : cached[i].pv) {
+            Move move;
+            if (!resolveMove(position, code, move)) break;
+            line.pv.push_back(move);
+            position.makeMove(move);
+        }
+        if (line.pv.empty()) return false;
+        line.move = line.pv.front();
+        lines.push_back(line);
+    }
+    return true;
+}
+
+void AnalysisCache::store(const Board& board, const std::vector<SearchLine>& lines) {
+    if (lines.empty()) return;
+
+    std::vector<CachedLine> result;
+    for (const SearchLine& line : lines) {
+        CachedLine entry{line.score, line.depth, {}};
+        for (const Move& move : line.pv) {
+            entry.pv.push_back(encodeMove(move));
+        }
+        result.push_back(std::move(entry));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<CachedLine>& cached = results[board.computeHash()];
+    if (!cached.empty()) {
+        int storedDepth = cached.front().depth;
+        if (storedDepth > lines.front().depth ||
+            (storedDepth == lines.front().depth && cached.size() >= lines.size())) {
+            return;
+        }
+    }
+    cached = std::move(result);
+}
+
+static bool fileExists(const std::string& path) {
+    return std::ifstream(path).good();
+}
+
+void SearchCache::load(const std::string& path) {
+    if (fileExists(path + ".tt")) {
+        RecordDatabase<TTRecord> records(path + ".tt");
+        for (const TTRecord& record : records) {
+            table.store(record.key, TTEntry{record.depth, record.score, record.flag, decodeMove(record.move)});
+        }
+    }
+
+    if (fileExists(path + ".analysis")) {
+        RecordDatabase<AnalysisRecord> records(path + ".analysis");
+        for (const AnalysisRecord& record : records) {
+            std::vector<AnalysisCache::CachedLine>& cached = analysis.results[record.key];
+            if (record.lineIndex == 0) cached.clear();  // A newer result for the same key
+            AnalysisCache::CachedLine line{record.score, record.depth, {}};
+            line.pv.assign(record.pv, record.pv + std::min<int>(record.pvLength, MAX_STORED_PV));
+            cached.push_back(std::move(line));
+        }
+    }
+}
+
+bool SearchCache::saveTable(const std::string& path) const {
+    RecordWriter<TTRecord> writer(path);
+    for (size_t i = 0; i < table.clusterCount; ++i) {
+        for (const TranspositionTable::Slot& slot : table.clusters[i].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if (data == 0) continue;
+            TTEntry entry = unpackEntry(data);
+            TTRecord record = {};
+            record.key = slot.check.load(std::memory_order_relaxed) ^ data;
+            record.score = entry.score;
+            record.depth = static_cast<int8_t>(entry.depth);
+            record.flag = static_cast<int8_t>(entry.flag);
+            record.move = encodeMove(entry.bestMove);
+            writer.write(record);
+        }
+    }
+    return writer.close();
+}
+
+bool SearchCache::saveAnalysis(const std::string& path) const {
+    RecordWriter<AnalysisRecord> writer(path);
+    for (const auto& [key, cached] : analysis.results) {
+        for (size_t i = 0; i < cached.size(); ++i) {
+            AnalysisRecord record = {};
+            record.key = key;
+            record.score = cached[i].score;
+            record.depth = static_cast<int16_t>(cached[i].depth);
+            record.lineIndex = static_cast<uint8_t>(i);
+            record.pvLength = static_cast<uint8_t>(std::min<size_t>(cached[i].pv.size(), MAX_STORED_PV));
+            std::copy_n(cached[i].pv.begin(), record.pvLength, record.pv);
+            writer.write(record);
+        }
+    }
+    return writer.close();
+}
+
+void SearchCache::save(const std::string& path) const {
+    const std::string tablePath = path + ".tt";
+    const std::string analysisPath = path + ".analysis";
+    std::string error;
+    try {
+        if (!saveTable(tablePath + ".tmp") || !saveAnalysis(analysisPath + ".tmp")) error = "write failed";
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    // The old snapshot is replaced only by a complete pair of files, so a
+    // failed save leaves it as it was and never mixes a new .tt with an old
+    // .analysis
+    if (!error.empty()) {
+        std::remove((tablePath + ".tmp").c_str());
+        std::remove((analysisPath + ".tmp").c_str());
+        throw std::runtime_error("Cannot save search cache " + path + " (" + error + "); previous snapshot kept");
+    }
+    if (std::rename((tablePath + ".tmp").c_str(), tablePath.c_str()) != 0 ||
+        std::rename((analysisPath + ".tmp").c_str(), analysisPath.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace search cache " + path);
+    }
+}
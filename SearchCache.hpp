@@ -0,0 +1,142 @@
+#ifndef SEARCH_CACHE_HPP
+#define SEARCH_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.hpp"
+#include "Engine.hpp"
+#include "LargePages.hpp"
+#include "Numa.hpp"
+
+// Transposition table entry; scores are from the side to move's view
+struct TTEntry {
+    int depth;
+    int score;
+    int flag;  // 0: Exact, -1: Alpha, 1: Beta
+    Move bestMove;
+};
+
+// Fixed-size table of 64-byte clusters of four entries in one allocation,
+// backed by huge pages where the system has them so a probe rarely misses
+// the TLB. Thread-safe without locks so several searches can share one
+// table: each slot holds its packed entry and the key XORed with it, and a
+// slot torn by concurrent writers reads as a miss.
+class TranspositionTable {
+public:
+    static constexpr size_t DEFAULT_MEGABYTES = 16;
+
+    explicit TranspositionTable(size_t megabytes = DEFAULT_MEGABYTES, bool hugePages = true) {
+        resize(megabytes, hugePages);
+    }
+
+    bool probe(uint64_t key, TTEntry& entry) const;
+
+    // Replaces the entry for the same key, else an empty slot, else the
+    // shallowest entry of the cluster
+    void store(uint64_t key, const TTEntry& entry);
+
+    // Starts loading the cluster of a key ahead of its probe
+    void prefetch(uint64_t key) const { __builtin_prefetch(&clusters[clusterIndex(key)]); }
+
+    void clear();
+
+    // Entries in use; walks the whole table
+    size_t size() const;
+
+    // Reallocates the table, dropping its contents
+    void resize(size_t megabytes, bool hugePages = true);
+
+    // Sizes the table to hold about this many entries; 0 keeps the default size
+    void setCapacity(size_t entries);
+
+    // Spreads the pages over the NUMA nodes so a table shared by workers on
+    // every node is not served from one; call while it is still empty
+    void interleave(NumaPolicy policy);
+
+    size_t megabytes() const { return memory.size() >> 20; }
+    PageKind pageKind() const { return memory.pageKind(); }
+
+private:
+    static constexpr int CLUSTER_SIZE = 4;
+
+    struct Slot {
+        std::atomic<uint64_t> check;  // Key XOR data
+        std::atomic<uint64_t> data;   // Packed entry; 0 when empty
+    };
+    struct alignas(64) Cluster {
+        Slot slots[CLUSTER_SIZE];
+    };
+    static_assert(sizeof(Cluster) == 64, "Cluster must fill one cache line");
+
+    LargePageBuffer memory;
+    Cluster* clusters = nullptr;
+    size_t clusterCount = 0;
+    bool hugePagesAllowed = true;
+    std::atomic<bool> dirty{false};  // Anything stored since the last clear
+
+    // Spreads keys over any cluster count without a modulo
+    size_t clusterIndex(uint64_t key) const {
+        return static_cast<size_t>((static_cast<unsigned __int128>(key) * clusterCount) >> 64);
+    }
+
+    friend struct SearchCache;
+};
+
+// Finished root analyses keyed by Zobrist hash, so a position analysed before
+// to at least the requested depth is answered without searching. Thread-safe.
+class AnalysisCache {
+public:
+    // Fills lines when the position was searched to at least depth with at
+    // least multiPV lines. Stored moves are re-checked against board, so a
+    // hash collision reads as a miss.
+    bool lookup(const Board& board, int depth, int multiPV, std::vector<SearchLine>& lines) const;
+
+    // Keeps the deeper (or, at equal depth, wider) of the stored and new result
+    void store(const Board& board, const std::vector<SearchLine>& lines);
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return results.size();
+    }
+
+private:
+    struct CachedLine {
+        int score;
+        int depth;
+        std::vector<uint16_t> pv;
+    };
+    std::unordered_map<uint64_t, std::vector<CachedLine>> results;
+    mutable std::mutex mutex;
+
+    friend struct SearchCache;
+};
+
+// Transposition table and analysis results that outlive a single search and,
+// through snapshot files, a single session. Zobrist keys come from a fixed
+// seed, so snapshots stay valid between runs.
+struct SearchCache {
+    TranspositionTable table;
+    AnalysisCache analysis;
+
+    // Merges the snapshot at path (path.tt and path.analysis, memory-mapped);
+    // missing files are skipped. Not safe while searches use the cache.
+    void load(const std::string& path);
+
+    // Writes the snapshot to temporary files and replaces the old pair only
+    // when both were written in full. Otherwise the old files are kept and
+    // std::runtime_error is thrown. Not safe while searches use the cache.
+    void save(const std::string& path) const;
+
+private:
+    // Each false if a write failed
+    bool saveTable(const std::string& path) const;
+    bool saveAnalysis(const std::string& path) const;
+};
+
+#endif  // SEARCH_CACHE_HPP
@@ -0,0 +1,150 @@
+#include "Tablebase.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+#ifdef USE_SYZYGY
+#include "tbprobe.h"
+#endif
+
+static int pieceLimit = 0;
+
+int tablebasePieceLimit() {
+    return pieceLimit;
+}
+
+#ifdef USE_SYZYGY
+
+struct TablebaseBitboards {
+    uint64_t white, black, kings, queens, rooks, bishops, knights, pawns;
+};
+
+static TablebaseBitboards toTablebaseBitboards(const Board& board) {
+    const auto& bb = board.bitboards;
+    TablebaseBitboards result;
+    result.white = bb[WhiteKing] | bb[WhiteQueen] | bb[WhiteBishop] | bb[WhiteKnight] | bb[WhiteRook] | bb[WhitePawn];
+    result.black = bb[BlackKing] | bb[BlackQueen] | bb[BlackBishop] | bb[BlackKnight] | bb[BlackRook] | bb[BlackPawn];
+    result.kings = bb[WhiteKing] | bb[BlackKing];
+    result.queens = bb[WhiteQueen] | bb[BlackQueen];
+    result.rooks = bb[WhiteRook] | bb[BlackRook];
+    result.bishops = bb[WhiteBishop] | bb[BlackBishop];
+    result.knights = bb[WhiteKnight] | bb[BlackKnight];
+    result.pawns = bb[WhitePawn] | bb[BlackPawn];
+    return result;
+}
+
+static bool hasCastlingRights(const Board& board) {
+    return std::any_of(board.castlingRooks.begin(), board.castlingRooks.end(),
+                       [](int rook) { return rook != -1; });
+}
+
+static int pieceCount(const Board& board) {
+    int count = 0;
+    for (uint64_t pieces : board.bitboards) {
+        count += __builtin_popcountll(pieces);
+    }
+    return count;
+}
+
+// Fathom's promotion codes: 1 queen, 2 rook, 3 bishop, 4 knight
+static int promotionCode(const Move& move) {
+    if (move.promotionPiece == 0) return TB_PROMOTES_NONE;
+    switch (move.promotionPiece % 6) {
+        case BasePieceType::Queen: return TB_PROMOTES_QUEEN;
+        case BasePieceType::Rook: return TB_PROMOTES_ROOK;
+        case BasePieceType::Bishop: return TB_PROMOTES_BISHOP;
+        default: return TB_PROMOTES_KNIGHT;
+    }
+}
+
+bool initTablebases(const std::string& path, int probeLimit) {
+    pieceLimit = 0;
+    if (path.empty() || !tb_init(path.c_str()) || TB_LARGEST == 0) {
+        return false;
+    }
+    pieceLimit = std::min<int>(probeLimit, TB_LARGEST);
+    return true;
+}
+
+bool probeWDL(const Board& board, TablebaseWDL& wdl) {
+    if (board.getHalfMoveClock() != 0 || hasCastlingRights(board) || pieceCount(board) > pieceLimit) {
+        return false;
+    }
+
+    TablebaseBitboards bb = toTablebaseBitboards(board);
+    unsigned result = tb_probe_wdl(bb.white, bb.black, bb.kings, bb.queens, bb.rooks, bb.bishops, bb.knights,
+                                   bb.pawns, 0, 0, board.enPassantTarget == -1 ? 0 : board.enPassantTarget,
+                                   board.colorTurn == 1);
+    if (result == TB_RESULT_FAILED) return false;
+
+    wdl = static_cast<TablebaseWDL>(static_cast<int>(result) - TB_DRAW);
+    return true;
+}
+
+bool probeRootDTZ(const Board& board, std::vector<Move>& rootMoves) {
+    if (hasCastlingRights(board) || pieceCount(board) > pieceLimit) {
+        return false;
+    }
+
+    // Fathom's root probe is not thread-safe, and every analysis server worker
+    // can reach it at once
+    static std::mutex rootProbeMutex;
+    TablebaseBitboards bb = toTablebaseBitboards(board);
+    unsigned results[TB_MAX_MOVES];
+    std::unique_lock<std::mutex> lock(rootProbeMutex);
+    unsigned best = tb_probe_root(bb.white, bb.black, bb.kings, bb.queens, bb.rooks, bb.bishops, bb.knights,
+                                  bb.pawns, board.getHalfMoveClock(), 0,
+                                  board.enPassantTarget == -1 ? 0 : board.enPassantTarget, board.colorTurn == 1,
+                                  results);
+    lock.unlock();
+    if (best == TB_RESULT_FAILED || best == TB_RESULT_CHECKMATE || best == TB_RESULT_STALEMATE) {
+        return false;
+    }
+
+    // WDL and DTZ of every legal root move
+    unsigned bestWDL = TB_GET_WDL(best);
+    unsigned bestDTZ = ~0u;
+    std::vector<std::pair<Move, unsigned>> scored;
+    for (const Move& move : rootMoves) {
+        for (int i = 0; results[i] != TB_RESULT_FAILED; ++i) {
+            unsigned result = results[i];
+            if (static_cast<int>(TB_GET_FROM(result)) == move.startSquare &&
+                static_cast<int>(TB_GET_TO(result)) == move.targetSquare &&
+                TB_GET_PROMOTES(result) == static_cast<unsigned>(promotionCode(move))) {
+                if (TB_GET_WDL(result) == bestWDL) {
+                    scored.emplace_back(move, TB_GET_DTZ(result));
+                    bestDTZ = std::min(bestDTZ, TB_GET_DTZ(result));
+                }
+                break;
+            }
+        }
+    }
+    if (scored.empty()) return false;
+
+    // When winning, only moves that reset or shorten the DTZ keep the win
+    // within the fifty-move rule; otherwise any result-preserving move will do
+    rootMoves.clear();
+    for (const auto& entry : scored) {
+        if (bestWDL != TB_WIN || entry.second == bestDTZ) {
+            rootMoves.push_back(entry.first);
+        }
+    }
+    return true;
+}
+
+#else
+
+bool initTablebases(const std::string&, int) {
+    pieceLimit = 0;
+    return false;
+}
+
+bool probeWDL(const Board&, TablebaseWDL&) {
+    return false;
+}
+
+bool probeRootDTZ(const Board&, std::vector<Move>&) {
+    return false;
+}
+
+#endif  // USE_SYZYGY
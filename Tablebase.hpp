@@ -0,0 +1,39 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+
+#include <string>
+#include <vector>
+
+#include "Board.hpp"
+
+// Syzygy endgame tablebases, probed through the Fathom library when the
+// build enables it (make SYZYGY=/path/to/Fathom). Table files are found in a
+// local directory and memory-mapped lazily on first probe. Without Fathom
+// every probe fails and the search runs as usual.
+
+enum TablebaseWDL {
+    TablebaseLoss = -2,
+    TablebaseBlessedLoss = -1,  // Loss saved by the fifty-move rule
+    TablebaseDraw = 0,
+    TablebaseCursedWin = 1,     // Win spoiled by the fifty-move rule
+    TablebaseWin = 2
+};
+
+// Scans path (directories separated by ':') for table files. Positions with
+// at most probeLimit pieces are probed, capped by the largest table found.
+// Returns false when no tables were found.
+bool initTablebases(const std::string& path, int probeLimit = 7);
+
+// Piece count at or below which probing is worthwhile; 0 when disabled
+int tablebasePieceLimit();
+
+// Win/draw/loss for the side to move. Only valid right after a capture or
+// pawn move (zero halfmove clock) with no castling rights, as in the tables.
+bool probeWDL(const Board& board, TablebaseWDL& wdl);
+
+// Reduces the legal root moves to those that keep the tablebase result and,
+// when winning, make the fastest progress by DTZ. Returns false when the root
+// position is not in the tables. Calls from several threads are serialised.
+bool probeRootDTZ(const Board& board, std::vector<Move>& rootMoves);
+
+#endif  // TABLEBASE_HPP
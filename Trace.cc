@@ -0,0 +1,118 @@
+#include "Trace.hpp"
+
+#ifdef USE_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// A deep search makes millions of moves; past this a thread keeps counting
+// but stops recording, so the trace stays loadable (about 100 MB per thread)
+static const size_t MAX_EVENTS_PER_THREAD = 1 << 22;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t durationNs;
+};
+
+// Every thread's events, gathered as the threads end and written out when
+// the program does
+class TraceLog {
+public:
+    static TraceLog& instance() {
+        static TraceLog log;
+        return log;
+    }
+
+    int newThreadId() { return nextThreadId++; }
+
+    void collect(int threadId, std::vector<TraceEvent>& events, uint64_t dropped) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(ThreadEvents{threadId, std::move(events)});
+        droppedEvents += dropped;
+    }
+
+    ~TraceLog() { write(); }
+
+private:
+    struct ThreadEvents {
+        int threadId;
+        std::vector<TraceEvent> events;
+    };
+
+    std::atomic<int> nextThreadId{0};
+    std::mutex mutex;
+    std::vector<ThreadEvents> threads;
+    uint64_t droppedEvents = 0;
+
+    void write();
+};
+
+void TraceLog::write() {
+    const char* path = std::getenv("CHESS_TRACE");
+    if (!path || !*path) path = "chess-trace.json";
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        std::cerr << "Cannot write trace " << path << std::endl;
+        return;
+    }
+
+    // Timestamps count from the first zone to start
+    uint64_t originNs = UINT64_MAX;
+    for (const ThreadEvents& thread : threads) {
+        for (const TraceEvent& event : thread.events) originNs = std::min(originNs, event.startNs);
+    }
+
+    // Complete ("X") events with microsecond timestamps, one track per thread
+    size_t eventCount = 0;
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+    bool first = true;
+    for (const ThreadEvents& thread : threads) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                     first ? "" : ",\n", thread.threadId, thread.threadId);
+        first = false;
+        for (const TraceEvent& event : thread.events) {
+            uint64_t start = event.startNs - originNs;
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%" PRIu64 ".%03" PRIu64
+                               ",\"dur\":%" PRIu64 ".%03" PRIu64 "}",
+                         event.name, thread.threadId, start / 1000, start % 1000, event.durationNs / 1000,
+                         event.durationNs % 1000);
+        }
+        eventCount += thread.events.size();
+    }
+    std::fputs("\n]}\n", file);
+    std::fclose(file);
+
+    std::cerr << "Trace: " << eventCount << " zones written to " << path;
+    if (droppedEvents > 0) std::cerr << " (" << droppedEvents << " dropped over the per-thread limit)";
+    std::cerr << std::endl;
+}
+
+// One thread's buffer, handed to the log when the thread exits. Touching the
+// log first constructs it first, so it is destroyed after the main thread's
+// buffer has been handed over.
+struct ThreadTrace {
+    TraceLog& log = TraceLog::instance();
+    int threadId = log.newThreadId();
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+
+    ~ThreadTrace() { log.collect(threadId, events, dropped); }
+};
+
+void recordTraceZone(const char* name, uint64_t startNs, uint64_t endNs) {
+    thread_local ThreadTrace trace;
+    if (trace.events.size() >= MAX_EVENTS_PER_THREAD) {
+        ++trace.dropped;
+        return;
+    }
+    trace.events.push_back(TraceEvent{name, startNs, endNs - startNs});
+}
+
+#endif  // USE_TRACE
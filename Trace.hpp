@@ -0,0 +1,52 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Scoped timing zones for finding where a slow move spent its time. Built
+// with `make TRACE=1` (-DUSE_TRACE), every TRACE_ZONE records its start and
+// duration in a per-thread buffer, and at exit all of them are written as
+// Chrome trace-event JSON to $CHESS_TRACE (default chess-trace.json), to be
+// opened in chrome://tracing or Perfetto. Otherwise TRACE_ZONE compiles to
+// nothing.
+//
+//   void Board::generateMoves() {
+//       TRACE_ZONE("Board::generateMoves");
+//       ...
+
+#ifdef USE_TRACE
+
+#include <chrono>
+#include <cstdint>
+
+inline uint64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Appends one finished zone to the calling thread's buffer. name must outlive
+// the program, as string literals do.
+void recordTraceZone(const char* name, uint64_t startNs, uint64_t endNs);
+
+class TraceZone {
+public:
+    explicit TraceZone(const char* name) : name(name), startNs(traceNow()) {}
+    ~TraceZone() { recordTraceZone(name, startNs, traceNow()); }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+
+#endif  // USE_TRACE
+
+#endif  // TRACE_HPP
@@ -0,0 +1,372 @@
+#include "Tuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Evaluation.hpp"
+#include "PositionDatabase.hpp"
+
+// Parameter layout: material[6] followed by pieceSquare[6][64]
+static const int MATERIAL_OFFSET = 0;
+static const int PIECE_SQUARE_OFFSET = 6;
+static const int PARAMETER_COUNT = PIECE_SQUARE_OFFSET + 6 * 64;
+
+// Records are processed in blocks: the sparse feature gather fills small
+// dense arrays, and the sigmoid/error pass runs over them in a tight loop the
+// compiler vectorizes
+static const int BLOCK_SIZE = 256;
+
+// Sigmoid arguments are clamped to this when gathered; the sigmoid is 0 or 1
+// to float precision well before it
+static const float SIGMOID_LIMIT = 80.0f;
+
+// 1 / (1 + e^-x) for |x| <= SIGMOID_LIMIT without a call to std::exp, which
+// would keep the dense pass scalar. e^-x is 2^n * 2^f, with 2^f from its
+// Taylor series on [0, 1) and 2^n put straight into the exponent bits;
+// relative error under 2e-5.
+static inline float sigmoid(float x) {
+    float t = -x * 1.44269504f;  // log2(e)
+    int n = static_cast<int>(t + 126.0f) - 126;  // floor(t), as t + 126 > 0
+    float f = t - static_cast<float>(n);
+    float power = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f +
+                  f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+    int32_t bits = (n + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return 1.0f / (1.0f + power * scale);
+}
+
+struct TunerPartial {
+    double loss = 0.0;
+    std::vector<double> gradient;
+};
+
+struct BlockFeatures {
+    uint16_t squareIndex[BLOCK_SIZE][32];  // baseType * 64 + square, from white's side
+    int8_t sign[BLOCK_SIZE][32];
+    uint8_t count[BLOCK_SIZE];
+};
+
+// Decodes a packed position into (piece-square index, sign) pairs. Must agree
+// with evaluatePosition.
+static int decodeFeatures(const PackedPosition& position, uint16_t* squareIndex, int8_t* sign) {
+    int count = 0;
+    uint64_t occupied = position.occupancy;
+    while (occupied && count < 32) {
+        int square = __builtin_ctzll(occupied);
+        occupied &= occupied - 1;
+
+        int code = (position.pieces[count / 2] >> ((count % 2) * 4)) & 0xF;
+        if (code == PackedPosition::CastlingRookWhite) code = PieceType::WhiteRook;
+        if (code == PackedPosition::CastlingRookBlack) code = PieceType::BlackRook;
+
+        bool white = code < 6;
+        squareIndex[count] = static_cast<uint16_t>((code % 6) * 64 + (white ? square : square ^ 56));
+        sign[count] = white ? 1 : -1;
+        ++count;
+    }
+    return count;
+}
+
+static void processRange(const TrainingRecord* records, size_t count, const std::vector<float>& params,
+                         double scale, double lambda, bool wantGradient, TunerPartial& partial) {
+    partial.loss = 0.0;
+    partial.gradient.assign(wantGradient ? PARAMETER_COUNT : 0, 0.0);
+
+    BlockFeatures features;
+    // The dense pass runs over whole blocks, as a fixed trip count is what
+    // the -O2 vectorizer accepts; entries past the end of a short block are
+    // finite leftovers and ignored
+    float evals[BLOCK_SIZE] = {};
+    float results[BLOCK_SIZE] = {};
+    float scores[BLOCK_SIZE] = {};
+    float errors[BLOCK_SIZE];
+    float factors[BLOCK_SIZE];
+    const float* material = params.data() + MATERIAL_OFFSET;
+    const float* pieceSquare = params.data() + PIECE_SQUARE_OFFSET;
+    const float floatScale = static_cast<float>(scale);
+    const float resultWeight = static_cast<float>(lambda);
+    const float scoreWeight = static_cast<float>(1.0 - lambda);
+
+    for (size_t base = 0; base < count; base += BLOCK_SIZE) {
+        int blockCount = static_cast<int>(std::min<size_t>(BLOCK_SIZE, count - base));
+
+        // Sparse gather: scaled evaluation, result and scaled score of each
+        // record
+        for (int i = 0; i < blockCount; ++i) {
+            const TrainingRecord& record = records[base + i];
+            int pieces = decodeFeatures(record.position, features.squareIndex[i], features.sign[i]);
+            features.count[i] = static_cast<uint8_t>(pieces);
+
+            float eval = 0.0f;
+            for (int p = 0; p < pieces; ++p) {
+                int index = features.squareIndex[i][p];
+                eval += features.sign[i][p] * (material[index / 64] + pieceSquare[index]);
+            }
+            evals[i] = std::clamp(floatScale * eval, -SIGMOID_LIMIT, SIGMOID_LIMIT);
+            results[i] = (record.result + 1) * 0.5f;
+            scores[i] = std::clamp(floatScale * record.score, -SIGMOID_LIMIT, SIGMOID_LIMIT);
+        }
+
+        // Dense pass: target, sigmoid, squared error and d(error)/d(eval).
+        // The loss is summed after it, since a float sum would have to be
+        // reordered to vectorize.
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            float target = resultWeight * results[i] + scoreWeight * sigmoid(scores[i]);
+            float predicted = sigmoid(evals[i]);
+            float error = predicted - target;
+            errors[i] = error * error;
+            factors[i] = 2.0f * error * predicted * (1.0f - predicted) * floatScale;
+        }
+        float blockLoss = 0.0f;
+        for (int i = 0; i < blockCount; ++i) {
+            blockLoss += errors[i];
+        }
+        partial.loss += blockLoss;
+
+        if (!wantGradient) continue;
+
+        // Sparse scatter of the gradient
+        for (int i = 0; i < blockCount; ++i) {
+            for (int p = 0; p < features.count[i]; ++p) {
+                int index = features.squareIndex[i][p];
+                double contribution = factors[i] * features.sign[i][p];
+                partial.gradient[MATERIAL_OFFSET + index / 64] += contribution;
+                partial.gradient[PIECE_SQUARE_OFFSET + index] += contribution;
+            }
+        }
+    }
+}
+
+// Worker threads started once per tuning run. Each loss evaluation hands
+// every worker its slice of the records and waits for all of them.
+class TunerPool {
+public:
+    TunerPool(const RecordDatabase<TrainingRecord>& data, int threadCount);
+    ~TunerPool();
+
+    TunerPool(const TunerPool&) = delete;
+    TunerPool& operator=(const TunerPool&) = delete;
+
+    // Mean loss (and gradient, when requested) over the whole data set
+    double computeLoss(const std::vector<double>& params, double k, double lambda, std::vector<double>* gradient);
+
+private:
+    const RecordDatabase<TrainingRecord>& data;
+    std::vector<std::thread> workers;
+    std::vector<TunerPartial> partials;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    uint64_t generation = 0;  // Bumped for each evaluation
+    int running = 0;
+    bool stopping = false;
+
+    // The evaluation in progress, read by the workers
+    std::vector<float> floatParams;
+    double scale = 0.0;
+    double lambda = 0.0;
+    bool wantGradient = false;
+
+    void worker(int index);
+};
+
+TunerPool::TunerPool(const RecordDatabase<TrainingRecord>& data, int threadCount)
+    : data(data), partials(threadCount) {
+    for (int t = 0; t < threadCount; ++t) {
+        workers.emplace_back(&TunerPool::worker, this, t);
+    }
+}
+
+TunerPool::~TunerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+void TunerPool::worker(int index) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&] { return generation != seen || stopping; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        size_t total = data.size();
+        size_t chunk = (total + workers.size() - 1) / workers.size();
+        size_t begin = std::min(total, index * chunk);
+        size_t count = std::min(total, begin + chunk) - begin;
+        processRange(data.begin() + begin, count, floatParams, scale, lambda, wantGradient, partials[index]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0) workDone.notify_one();
+    }
+}
+
+double TunerPool::computeLoss(const std::vector<double>& params, double k, double lambda,
+                              std::vector<double>* gradient) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        floatParams.assign(params.begin(), params.end());
+        scale = k * std::log(10.0) / 400.0;
+        this->lambda = lambda;
+        wantGradient = gradient != nullptr;
+        running = static_cast<int>(workers.size());
+        ++generation;
+        workAvailable.notify_all();
+        workDone.wait(lock, [this] { return running == 0; });
+    }
+
+    size_t total = data.size();
+    double loss = 0.0;
+    if (gradient) gradient->assign(PARAMETER_COUNT, 0.0);
+    for (const TunerPartial& partial : partials) {
+        loss += partial.loss;
+        if (gradient) {
+            for (int i = 0; i < PARAMETER_COUNT; ++i) {
+                (*gradient)[i] += partial.gradient[i] / total;
+            }
+        }
+    }
+    return loss / total;
+}
+
+// Scaling constant K that best maps the starting evaluation onto the results
+static double findScalingConstant(TunerPool& pool, const std::vector<double>& params, double lambda) {
+    double low = 0.05;
+    double high = 3.0;
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    for (int iteration = 0; iteration < 30; ++iteration) {
+        double left = high - ratio * (high - low);
+        double right = low + ratio * (high - low);
+        if (pool.computeLoss(params, left, lambda, nullptr) < pool.computeLoss(params, right, lambda, nullptr)) {
+            high = right;
+        } else {
+            low = left;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+static bool writeWeightsHeader(const std::string& path, const EvalWeights& weights, size_t positions,
+                               double loss) {
+    static const char* const pieceNames[6] = {"King", "Queen", "Bishop", "Knight", "Rook", "Pawn"};
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    out << "// Evaluation weights written by ./chess tune. Regenerate rather than edit.\n"
+        << "// Source: " << positions << " positions, final loss " << loss << "\n"
+        << "#ifndef TUNED_WEIGHTS_HPP\n"
+        << "#define TUNED_WEIGHTS_HPP\n\n"
+        << "#include \"Evaluation.hpp\"\n\n"
+        << "static const EvalWeights TUNED_WEIGHTS = {\n"
+        << "    // Material: king, queen, bishop, knight, rook, pawn\n"
+        << "    {";
+    for (int type = 0; type < 6; ++type) {
+        out << weights.material[type] << (type < 5 ? ", " : "},\n");
+    }
+    out << "    // Piece-square tables from white's side, rank 1 first\n"
+        << "    {\n";
+    for (int type = 0; type < 6; ++type) {
+        out << "        {  // " << pieceNames[type] << "\n";
+        for (int rank = 0; rank < 8; ++rank) {
+            out << "            ";
+            for (int file = 0; file < 8; ++file) {
+                out << weights.pieceSquare[type][rank * 8 + file] << (file < 7 ? ", " : ",\n");
+            }
+        }
+        out << "        },\n";
+    }
+    out << "    },\n"
+        << "};\n\n"
+        << "#endif  // TUNED_WEIGHTS_HPP\n";
+    return static_cast<bool>(out);
+}
+
+int runTuner(const TunerOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    RecordDatabase<TrainingRecord> data(options.dataPath);
+    if (data.size() == 0) {
+        std::cerr << "No positions in " << options.dataPath << std::endl;
+        return 1;
+    }
+    int threadCount = std::max(1, options.threads);
+
+    // Start from the weights the engine currently uses
+    const EvalWeights& initial = defaultEvalWeights();
+    std::vector<double> params(PARAMETER_COUNT);
+    for (int type = 0; type < 6; ++type) {
+        params[MATERIAL_OFFSET + type] = initial.material[type];
+        for (int square = 0; square < 64; ++square) {
+            params[PIECE_SQUARE_OFFSET + type * 64 + square] = initial.pieceSquare[type][square];
+        }
+    }
+
+    TunerPool pool(data, threadCount);
+    double k = findScalingConstant(pool, params, options.lambda);
+    std::cout << "Tuning " << PARAMETER_COUNT << " parameters on " << data.size() << " positions with "
+              << threadCount << " threads, K = " << k << std::endl;
+
+    // Adam
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    const double epsilon = 1e-8;
+    std::vector<double> gradient;
+    std::vector<double> firstMoment(PARAMETER_COUNT, 0.0);
+    std::vector<double> secondMoment(PARAMETER_COUNT, 0.0);
+    double loss = 0.0;
+
+    for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+        auto start = Clock::now();
+        loss = pool.computeLoss(params, k, options.lambda, &gradient);
+
+        double correction1 = 1.0 - std::pow(beta1, epoch);
+        double correction2 = 1.0 - std::pow(beta2, epoch);
+        for (int i = 0; i < PARAMETER_COUNT; ++i) {
+            if (i == MATERIAL_OFFSET + BasePieceType::King) continue;  // Cancels out, keep it fixed
+            firstMoment[i] = beta1 * firstMoment[i] + (1.0 - beta1) * gradient[i];
+            secondMoment[i] = beta2 * secondMoment[i] + (1.0 - beta2) * gradient[i] * gradient[i];
+            params[i] -= options.learningRate * (firstMoment[i] / correction1) /
+                         (std::sqrt(secondMoment[i] / correction2) + epsilon);
+        }
+
+        if (epoch == 1 || epoch % 10 == 0 || epoch == options.epochs) {
+            auto epochMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+            std::cout << "Epoch " << epoch << "  loss " << loss << "  (" << epochMs << " ms)" << std::endl;
+        }
+    }
+
+    EvalWeights tuned;
+    for (int type = 0; type < 6; ++type) {
+        tuned.material[type] = static_cast<int>(std::lround(params[MATERIAL_OFFSET + type]));
+        for (int square = 0; square < 64; ++square) {
+            tuned.pieceSquare[type][square] =
+                static_cast<int>(std::lround(params[PIECE_SQUARE_OFFSET + type * 64 + square]));
+        }
+    }
+
+    if (!writeWeightsHeader(options.outputPath, tuned, data.size(), loss)) {
+        std::cerr << "Cannot write " << options.outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << options.outputPath << "; rebuild to use the new weights" << std::endl;
+    return 0;
+}
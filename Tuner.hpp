@@ -0,0 +1,20 @@
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+#include <string>
+
+struct TunerOptions {
+    std::string dataPath;                         // TrainingRecord file from datagen
+    std::string outputPath = "TunedWeights.hpp";
+    int epochs = 300;
+    int threads = 1;
+    double learningRate = 1.0;                    // Adam step size in centipawns
+    double lambda = 1.0;                          // Target weight of game result vs. search score
+};
+
+// Texel-style tuning: minimises the squared error between the sigmoid of
+// evaluatePosition and the game outcome over every EvalWeights parameter,
+// then writes the result as a TunedWeights.hpp header for the engine
+int runTuner(const TunerOptions& options);
+
+#endif  // TUNER_HPP
@@ -0,0 +1,245 @@
+#include "Uci.hpp"
+
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BasicEngine.hpp"
+#include "Board.hpp"
+#include "Notation.hpp"
+#include "SearchCache.hpp"
+#include "Tablebase.hpp"
+
+static const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+class UciSession {
+public:
+    int run();
+
+private:
+    BasicEngine engine;
+    Board board{START_FEN};
+    std::shared_ptr<SearchCache> cache;
+    std::string cachePath;            // SearchCache option; saved on quit
+    int depth = 5;                    // Depth option; go depth overrides it per search
+    int multiPV = 1;
+    bool chess960 = false;
+
+    std::thread searchThread;
+    std::mutex mutex;                 // Guards pondering and output
+    std::condition_variable ponderReleased;
+    bool pondering = false;           // bestmove is held back while set
+
+    bool dispatch(const std::string& command, std::istringstream& input);
+    void send(const std::string& line);
+    void setOption(std::istringstream& input);
+    void setPosition(std::istringstream& input);
+    void go(std::istringstream& input);
+    void ponderHit();
+    void stopSearch();
+    void saveCache();
+    void search(Board position);
+};
+
+void UciSession::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << line << std::endl;
+}
+
+void UciSession::setOption(std::istringstream& input) {
+    // setoption name <name...> [value <value...>]
+    std::string token, name, value;
+    input >> token;
+    while (input >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    while (input >> token) {
+        value += (value.empty() ? "" : " ") + token;
+    }
+
+    if (name == "Depth") {
+        depth = std::max(1, std::stoi(value));
+    } else if (name == "Hash") {
+        stopSearch();
+        engine.setHashSize(std::max(1, std::stoi(value)));
+    } else if (name == "MultiPV") {
+        multiPV = std::max(1, std::stoi(value));
+    } else if (name == "UCI_Chess960") {
+        chess960 = (value == "true");
+    } else if (name == "SearchCache") {
+        saveCache();
+        cachePath = (value == "<empty>") ? "" : value;
+        cache = cachePath.empty() ? nullptr : std::make_shared<SearchCache>();
+        if (cache) cache->load(cachePath);
+        engine.setSearchCache(cache);
+    } else if (name == "SyzygyPath") {
+        if (initTablebases(value == "<empty>" ? "" : value)) {
+            send("info string Syzygy tablebases up to " + std::to_string(tablebasePieceLimit()) + " pieces");
+        }
+    }
+}
+
+void UciSession::setPosition(std::istringstream& input) {
+    // position startpos | fen <fields...> [moves <move...>]
+    std::string token, fen;
+    input >> token;
+    if (token == "startpos") {
+        fen = START_FEN;
+        input >> token;
+    } else if (token == "fen") {
+        while (input >> token && token != "moves") {
+            fen += token + " ";
+        }
+    } else {
+        return;
+    }
+
+    board.loadFEN(fen);
+    while (input >> token) {
+        Move move;
+        if (!parseUCIMove(board, token, move)) {
+            send("info string illegal move " + token);
+            break;
+        }
+        board.makeMove(move);
+    }
+}
+
+void UciSession::go(std::istringstream& input) {
+    stopSearch();
+
+    // Time controls are ignored: the engine searches to a fixed depth
+    std::string token;
+    bool ponder = false;
+    int searchDepth = depth;
+    while (input >> token) {
+        if (token == "depth") {
+            input >> searchDepth;
+        } else if (token == "ponder" || token == "infinite") {
+            ponder = true;
+        }
+    }
+
+    engine.setDepth(std::max(1, searchDepth));
+    pondering = ponder;
+    searchThread = std::thread(&UciSession::search, this, board);
+}
+
+void UciSession::search(Board position) {
+    std::vector<SearchLine> lines = engine.analyze(position, multiPV);
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const SearchLine& line = lines[i];
+        std::string info = "info depth " + std::to_string(line.depth) + " multipv " + std::to_string(i + 1) +
+                           " score " + BasicEngine::formatScore(line.score) + " nodes " +
+                           std::to_string(engine.getNodeCount()) + " pv";
+        for (const Move& move : line.pv) {
+            info += " " + moveToUCI(move, chess960);
+        }
+        send(info);
+    }
+
+    // While pondering the search carries on through ponderhit; the move is
+    // only reported once the GUI releases it
+    std::unique_lock<std::mutex> lock(mutex);
+    ponderReleased.wait(lock, [this] { return !pondering; });
+
+    Move best;
+    if (!lines.empty()) {
+        best = lines.front().move;
+    } else if (!position.moves.empty()) {
+        best = position.moves.front();  // Stopped before any move was searched
+    }
+    std::string text = "bestmove " + moveToUCI(best, chess960);
+    if (!lines.empty() && lines.front().pv.size() > 1) {
+        text += " ponder " + moveToUCI(lines.front().pv[1], chess960);
+    }
+    std::cout << text << std::endl;
+}
+
+void UciSession::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pondering = false;
+    }
+    ponderReleased.notify_all();
+}
+
+void UciSession::stopSearch() {
+    if (!searchThread.joinable()) return;
+    engine.stop();
+    ponderHit();
+    searchThread.join();
+    engine.clearStop();
+}
+
+int UciSession::run() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream input(line);
+        std::string command;
+        input >> command;
+
+        try {
+            if (!dispatch(command, input)) break;
+        } catch (const std::exception& e) {
+            send(std::string("info string error: ") + e.what());  // Bad FEN or option value
+        }
+    }
+    stopSearch();
+    saveCache();
+    return 0;
+}
+
+// Handles one command; returns false on quit
+bool UciSession::dispatch(const std::string& command, std::istringstream& input) {
+    if (command == "uci") {
+        send("id name chess960-engine\n"
+             "id author chess960-engine contributors\n"
+             "option name Depth type spin default 5 min 1 max 64\n"
+             "option name Hash type spin default 16 min 1 max 33554432\n"
+             "option name MultiPV type spin default 1 min 1 max 256\n"
+             "option name Ponder type check default true\n"
+             "option name UCI_Chess960 type check default false\n"
+             "option name SyzygyPath type string default <empty>\n"
+             "option name SearchCache type string default <empty>\n"
+             "uciok");
+        if (tablebasePieceLimit() > 0) {
+            send("info string Syzygy tablebases up to " + std::to_string(tablebasePieceLimit()) + " pieces");
+        }
+    } else if (command == "isready") {
+        send("readyok");
+    } else if (command == "setoption") {
+        setOption(input);
+    } else if (command == "ucinewgame") {
+        stopSearch();
+        board.loadFEN(START_FEN);
+    } else if (command == "position") {
+        stopSearch();
+        setPosition(input);
+    } else if (command == "go") {
+        go(input);
+    } else if (command == "ponderhit") {
+        ponderHit();
+    } else if (command == "stop") {
+        stopSearch();
+    } else if (command == "quit") {
+        return false;
+    }
+    return true;
+}
+
+void UciSession::saveCache() {
+    stopSearch();
+    if (cache) cache->save(cachePath);
+}
+
+int runUci() {
+    UciSession session;
+    return session.run();
+}
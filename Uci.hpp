@@ -0,0 +1,8 @@
+#ifndef UCI_HPP
+#define UCI_HPP
+
+// Speaks the UCI protocol on stdin/stdout with the Basic engine, including
+// go ponder / ponderhit, MultiPV and UCI_Chess960. Returns on quit or EOF.
+int runUci();
+
+#endif  // UCI_HPP
@@ -1,119 +1,55 @@
 #include <SFML/Graphics.hpp>
 #include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <string>
+#include <thread>
 
+#include "AnalysisServer.hpp"
+#include "Bench.hpp"
 #include "Board.hpp"
+#include "BookBuilder.hpp"
+#include "Chess960.hpp"
+#include "DataGenerator.hpp"
+#include "Notation.hpp"
+#include "Perft.hpp"
 #include "Piece.hpp"
+#include "Ponderer.hpp"
+#include "PositionDatabase.hpp"
 #include "RandomEngine.hpp"
+#include "SearchCache.hpp"
+#include "Tablebase.hpp"
+#include "Trace.hpp"
+#include "Tuner.hpp"
+#include "Uci.hpp"
 #include "BasicEngine.hpp"
 
 const int BOARD_SIZE = 8;
 const int SQUARE_SIZE = 80;
 const int PIECE_SPRITE_SIZE = 133;
+const float PIECE_SCALE = 0.6f;  // Sprite sheet cells are scaled down to fit a square
+
+// Chess960 perft reference counts checked by ./chess perft960 (see README)
+const char* const CHESS960_PERFT_PATH = "assets/chess960_perft.epd";
+
+// Optional opening books, consulted in this order (see ./chess book)
+const char* const BOOK_PATHS[] = {"assets/book.bin", "assets/chess960.bin"};
 
 bool isInsideBoard(int x, int y) {
     return x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE;
 }
 
-void generateChess960Position(int N, std::string& epd) {
-    std::vector<char> positions(8, '1');
-
-    int N1 = N;
-
-    // Step a: Place bishops on opposite colors
-    int B1 = N1 % 4;
-    N1 = N1 / 4;
-    std::vector<int> lightSquares = {1,3,5,7};
-    positions[lightSquares[B1]] = 'B';
-
-    int B2 = N1 % 4;
-    N1 = N1 / 4;
-    std::vector<int> darkSquares = {0,2,4,6};
-    positions[darkSquares[B2]] = 'B';
-
-    // Step b: Place queen
-    std::vector<int> emptySquares;
-    for(int i = 0; i < 8; ++i) {
-        if(positions[i] == '1') emptySquares.push_back(i);
-    }
-    int Q = N1 % 6;
-    N1 = N1 / 6;
-    positions[emptySquares[Q]] = 'Q';
-
-    // Step c: Place knights
-    emptySquares.clear();
-    for(int i = 0; i < 8; ++i) {
-        if(positions[i] == '1') emptySquares.push_back(i);
-    }
-    int N4 = N1 % 10;
-
-    int knight1, knight2;
-    switch(N4) {
-        case 0: knight1 = 0; knight2 = 1; break;
-        case 1: knight1 = 0; knight2 = 2; break;
-        case 2: knight1 = 0; knight2 = 3; break;
-        case 3: knight1 = 0; knight2 = 4; break;
-        case 4: knight1 = 1; knight2 = 2; break;
-        case 5: knight1 = 1; knight2 = 3; break;
-        case 6: knight1 = 1; knight2 = 4; break;
-        case 7: knight1 = 2; knight2 = 3; break;
-        case 8: knight1 = 2; knight2 = 4; break;
-        case 9: knight1 = 3; knight2 = 4; break;
-    }
-    positions[emptySquares[knight1]] = 'N';
-    positions[emptySquares[knight2]] = 'N';
-
-    // Step d: Place remaining pieces R K R, with king between rooks
-    emptySquares.clear();
-    for(int i = 0; i < 8; ++i) {
-        if(positions[i] == '1') emptySquares.push_back(i);
-    }
-    // There should be exactly 3 empty squares left
-    positions[emptySquares[0]] = 'R';
-    positions[emptySquares[1]] = 'K';
-    positions[emptySquares[2]] = 'R';
-
-    // Convert positions to EPD string
-    std::string firstRank;
-    for(char c : positions) {
-        firstRank += c;
-    }
-    // Simplify the string by replacing sequences of '1's with numbers
-    std::string simplifiedRank;
-    int emptyCount = 0;
-    for(char c : firstRank) {
-        if(c == '1') {
-            emptyCount++;
-        } else {
-            if(emptyCount > 0) {
-                simplifiedRank += std::to_string(emptyCount);
-                emptyCount = 0;
-            }
-            simplifiedRank += c;
-        }
-    }
-    if(emptyCount > 0) {
-        simplifiedRank += std::to_string(emptyCount);
+std::string drawMessage(GameStatus status) {
+    switch (status) {
+        case GameStatus::Stalemate: return "Draw by stalemate!";
+        case GameStatus::Repetition: return "Draw by threefold repetition!";
+        case GameStatus::FiftyMoves: return "Draw by the fifty-move rule!";
+        case GameStatus::InsufficientMaterial: return "Draw by insufficient material!";
+        default: return "The game is a draw!";
     }
-
-    std::string secondRank = "PPPPPPPP";
-    std::string seventhRank = "pppppppp";
-
-    // For black's back rank, we mirror the simplifiedRank and convert to lowercase
-    std::string blackFirstRank = "";
-    for(int i = simplifiedRank.size() - 1; i >= 0; --i) {
-        char c = simplifiedRank[i];
-        if(c >= 'A' && c <= 'Z') {
-            blackFirstRank += std::tolower(c);
-        } else {
-            blackFirstRank += c;
-        }
-    }
-
-
-    epd = blackFirstRank + "/pppppppp/8/8/8/8/PPPPPPPP/" + simplifiedRank;
 }
 
 class ChessGame {
@@ -122,6 +58,14 @@ class ChessGame {
     sf::Texture piecesTexture;
     sf::Sprite pieceSprite;
     sf::RectangleShape square;
+    // The checkerboard never changes, so it is rendered once; highlights and
+    // pieces are batched into one vertex array each and drawn on top
+    sf::RenderTexture boardLayer;
+    sf::Sprite boardLayerSprite;
+    sf::VertexArray highlightVertices{sf::Quads};
+    sf::VertexArray pieceVertices{sf::Quads};
+    bool piecesDirty = true;  // Pieces moved since pieceVertices was built
+    bool needsRedraw = true;  // The window no longer shows the current state
     sf::CircleShape targetIndicator;
     sf::RectangleShape promotionBackground;
     sf::Font font;
@@ -144,6 +88,9 @@ class ChessGame {
 
     std::unique_ptr<Engine> whiteEngine;
     std::unique_ptr<Engine> blackEngine;
+    // Declared after the engines so they stop searching before those are destroyed
+    Ponderer whitePonderer;
+    Ponderer blackPonderer;
 
     sf::Text whiteSelectionText;
     sf::Text blackSelectionText;
@@ -166,15 +113,29 @@ class ChessGame {
     sf::Text randomEngineText;
     sf::Text basicEngineText;
     bool useRandomEngine = true;
+    std::vector<std::shared_ptr<const OpeningBook>> openingBooks;
 
     void loadAssets() {
         if (!piecesTexture.loadFromFile("assets/Chess_Pieces_Sprite.png")) {
             throw std::runtime_error("Failed to load piece sprite");
         }
         pieceSprite.setTexture(piecesTexture);
-        pieceSprite.setScale(0.6f, 0.6f);
+        pieceSprite.setScale(PIECE_SCALE, PIECE_SCALE);
 
         square.setSize(sf::Vector2f(SQUARE_SIZE, SQUARE_SIZE));
+        if (!boardLayer.create(BOARD_SIZE * SQUARE_SIZE, BOARD_SIZE * SQUARE_SIZE)) {
+            throw std::runtime_error("Failed to create board texture");
+        }
+        boardLayer.clear(sf::Color::White);
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            for (int j = 0; j < BOARD_SIZE; ++j) {
+                square.setPosition(i * SQUARE_SIZE, j * SQUARE_SIZE);
+                square.setFillColor((i + j) % 2 == 0 ? sf::Color(238, 238, 210) : sf::Color(118, 150, 86));
+                boardLayer.draw(square);
+            }
+        }
+        boardLayer.display();
+        boardLayerSprite.setTexture(boardLayer.getTexture());
 
         targetIndicator.setRadius(SQUARE_SIZE / 6);
         targetIndicator.setFillColor(sf::Color(128, 128, 128, 128));
@@ -247,25 +208,54 @@ class ChessGame {
         basicEngineText.setString("Basic");
     }
 
+    void loadOpeningBooks() {
+        for (const char* path : BOOK_PATHS) {
+            try {
+                openingBooks.push_back(openOpeningBook(path));
+                std::cout << "Loaded opening book " << path << " ("
+                          << openingBooks.back()->size() << " entries)" << std::endl;
+            } catch (const std::exception& e) {
+                // Books are optional, but one that exists and was refused is
+                // worth a word
+                if (std::ifstream(path)) std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+
     void handleEvents() {
         sf::Event event;
         while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
-            } else if (event.type == sf::Event::MouseButtonPressed) {
-                if (showMenu) {
-                    handleMenuClick(event);
-                } else {
-                    handleMousePress(event);
-                }
-            } else if (event.type == sf::Event::MouseButtonReleased) {
-                if (!showMenu) {
-                    handleMouseRelease(event);
-                }
+            handleEvent(event);
+        }
+    }
+
+    void handleEvent(const sf::Event& event) {
+        // Only a dragged piece follows the mouse; other movement changes nothing
+        if (event.type != sf::Event::MouseMoved || isMoving) {
+            needsRedraw = true;
+        }
+
+        if (event.type == sf::Event::Closed) {
+            window.close();
+        } else if (event.type == sf::Event::MouseButtonPressed) {
+            if (showMenu) {
+                handleMenuClick(event);
+            } else {
+                handleMousePress(event);
+            }
+        } else if (event.type == sf::Event::MouseButtonReleased) {
+            if (!showMenu) {
+                handleMouseRelease(event);
             }
         }
     }
 
+    // Marks the piece layer for a rebuild and the window for a redraw
+    void positionChanged() {
+        piecesDirty = true;
+        needsRedraw = true;
+    }
+
     void handleMenuClick(const sf::Event& event) {
         sf::Vector2i mousePos = sf::Mouse::getPosition(window);
         if (startButton.getGlobalBounds().contains(mousePos.x, mousePos.y)) {
@@ -313,6 +303,7 @@ class ChessGame {
                 int baseType = promotionPieceTypes[selectedPiece];
                 pendingPromotion->promotionPiece = baseType + (board->colorTurn == 1 ? 0 : 6);
                 board->makeMove(*pendingPromotion);
+                positionChanged();
                 pendingPromotion.reset();
                 showPromotionInterface = false;
             }
@@ -332,12 +323,17 @@ class ChessGame {
             for (const Move& move : board->moves) {
                 if (move.startSquare == startSquare) {
                     targetSquares.push_back(move.targetSquare);
+                    // Castling can also be played by dropping the king on its destination
+                    if (move.isCastling && Board::castlingKingTarget(move) != startSquare) {
+                        targetSquares.push_back(Board::castlingKingTarget(move));
+                    }
                 }
             }
             if (!targetSquares.empty()) {
                 isMoving = true;
                 movingPieceIndex = pieceIndex;
                 movingPieceOrigin = sf::Vector2i(boxX, boxY);
+                positionChanged();  // The dragged piece leaves its square
             }
         }
     }
@@ -366,7 +362,9 @@ class ChessGame {
                                        return move.startSquare ==
                                                   (movingPieceOrigin.y * 8 +
                                                    movingPieceOrigin.x) &&
-                                              move.targetSquare == targetSquare;
+                                              (move.targetSquare == targetSquare ||
+                                               (move.isCastling &&
+                                                Board::castlingKingTarget(move) == targetSquare));
                                    });
 
             if (it != board->moves.end()) {
@@ -380,65 +378,75 @@ class ChessGame {
         }
 
         isMoving = false;
+        positionChanged();
         clickedSquare = sf::Vector2i(-1, -1);
         targetSquares.clear();
     }
 
     void drawBoard() {
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                square.setPosition(i * SQUARE_SIZE, j * SQUARE_SIZE);
-                square.setFillColor(getBoardSquareColor(i, j));
-                window.draw(square);
+        window.draw(boardLayerSprite);
 
-                drawPiece(i, j);
-                drawTargetIndicator(i, j);
-            }
+        // Last move and selected square, the latter taking precedence
+        highlightVertices.clear();
+        if (board->lastMove.startSquare != -1) {
+            addHighlight(board->lastMove.startSquare, sf::Color(255, 255, 128));
+            addHighlight(board->lastMove.targetSquare, sf::Color(255, 255, 128));
         }
-    }
-
-    sf::Color getBoardSquareColor(int i, int j) {
-        if (clickedSquare.x == i && clickedSquare.y == j) {
-            return sf::Color(236, 126, 106);
-        } else if (board->isLastMoveTile(j * 8 + i)) {
-            return sf::Color(255, 255, 0, 128);
-        } else if ((i + j) % 2 == 0) {
-            return sf::Color(238, 238, 210);
-        } else {
-            return sf::Color(118, 150, 86);
+        if (isInsideBoard(clickedSquare.x, clickedSquare.y)) {
+            addHighlight(clickedSquare.y * 8 + clickedSquare.x, sf::Color(236, 126, 106));
         }
-    }
-
-    void drawPiece(int i, int j) {
-        int squareIndex = j * 8 + i;
-        int pieceIndex = board->getPieceAt(squareIndex);
+        window.draw(highlightVertices);
 
-        if (pieceIndex != -1 &&
-            (!isMoving || (i != movingPieceOrigin.x || j != movingPieceOrigin.y))) {
-            int basePieceType = pieceIndex % 6;
-            int color = (pieceIndex < 6) ? 0 : 1;
-
-            // Map basePieceType to asset index
-            int assetIndex = basePieceType;
-
-            pieceSprite.setTextureRect(
-                sf::IntRect(assetIndex * PIECE_SPRITE_SIZE, color * PIECE_SPRITE_SIZE,
-                            PIECE_SPRITE_SIZE, PIECE_SPRITE_SIZE));
-            pieceSprite.setPosition(i * SQUARE_SIZE, j * SQUARE_SIZE);
-            window.draw(pieceSprite);
+        if (piecesDirty) {
+            buildPieceVertices();
         }
-    }
+        window.draw(pieceVertices, &piecesTexture);
 
-    void drawTargetIndicator(int i, int j) {
-        if (std::find(targetSquares.begin(), targetSquares.end(), j * 8 + i) !=
-            targetSquares.end()) {
+        for (int targetSquare : targetSquares) {
             targetIndicator.setPosition(
-                i * SQUARE_SIZE + SQUARE_SIZE / 2 - SQUARE_SIZE / 6,
-                j * SQUARE_SIZE + SQUARE_SIZE / 2 - SQUARE_SIZE / 6);
+                (targetSquare % 8) * SQUARE_SIZE + SQUARE_SIZE / 2 - SQUARE_SIZE / 6,
+                (targetSquare / 8) * SQUARE_SIZE + SQUARE_SIZE / 2 - SQUARE_SIZE / 6);
             window.draw(targetIndicator);
         }
     }
 
+    void addHighlight(int squareIndex, sf::Color color) {
+        float x = (squareIndex % 8) * SQUARE_SIZE;
+        float y = (squareIndex / 8) * SQUARE_SIZE;
+        highlightVertices.append(sf::Vertex(sf::Vector2f(x, y), color, sf::Vector2f()));
+        highlightVertices.append(sf::Vertex(sf::Vector2f(x + SQUARE_SIZE, y), color, sf::Vector2f()));
+        highlightVertices.append(sf::Vertex(sf::Vector2f(x + SQUARE_SIZE, y + SQUARE_SIZE), color, sf::Vector2f()));
+        highlightVertices.append(sf::Vertex(sf::Vector2f(x, y + SQUARE_SIZE), color, sf::Vector2f()));
+    }
+
+    // One textured quad per piece, read straight from the bitboards. The piece
+    // being dragged is left out; drawMovingPiece draws it under the mouse.
+    void buildPieceVertices() {
+        const float size = PIECE_SPRITE_SIZE * PIECE_SCALE;
+        uint64_t hidden = isMoving ? 1ULL << (movingPieceOrigin.y * 8 + movingPieceOrigin.x) : 0;
+
+        pieceVertices.clear();
+        for (int pieceIndex = 0; pieceIndex < 12; ++pieceIndex) {
+            float u = (pieceIndex % 6) * PIECE_SPRITE_SIZE;
+            float v = (pieceIndex < 6 ? 0 : 1) * PIECE_SPRITE_SIZE;
+            uint64_t pieces = board->bitboards[pieceIndex] & ~hidden;
+            while (pieces) {
+                int squareIndex = __builtin_ctzll(pieces);
+                pieces &= pieces - 1;
+                float x = (squareIndex % 8) * SQUARE_SIZE;
+                float y = (squareIndex / 8) * SQUARE_SIZE;
+                pieceVertices.append(sf::Vertex(sf::Vector2f(x, y), sf::Vector2f(u, v)));
+                pieceVertices.append(sf::Vertex(sf::Vector2f(x + size, y),
+                                                sf::Vector2f(u + PIECE_SPRITE_SIZE, v)));
+                pieceVertices.append(sf::Vertex(sf::Vector2f(x + size, y + size),
+                                                sf::Vector2f(u + PIECE_SPRITE_SIZE, v + PIECE_SPRITE_SIZE)));
+                pieceVertices.append(sf::Vertex(sf::Vector2f(x, y + size),
+                                                sf::Vector2f(u, v + PIECE_SPRITE_SIZE)));
+            }
+        }
+        piecesDirty = false;
+    }
+
     void drawMovingPiece() {
         if (isMoving) {
             sf::Vector2i mousePos = sf::Mouse::getPosition(window);
@@ -487,7 +495,7 @@ class ChessGame {
             menuText.setPosition(SQUARE_SIZE, BOARD_SIZE * SQUARE_SIZE / 2 - 150);
             window.draw(menuText);
         } else if (isDraw) {
-            menuText.setString("The game is a draw!");
+            menuText.setString(drawMessage(board->getStatus()));
             menuText.setPosition(SQUARE_SIZE, BOARD_SIZE * SQUARE_SIZE / 2 - 150);
             window.draw(menuText);
         }
@@ -555,9 +563,27 @@ class ChessGame {
 
     void makeEngineMove() {
         if ((board->colorTurn == 1 && whiteEngine) || (board->colorTurn == -1 && blackEngine)) {
-            Engine* currentEngine = (board->colorTurn == 1) ? whiteEngine.get() : blackEngine.get();
-            Move bestMove = currentEngine->getBestMove(*board);
+            bool white = board->colorTurn == 1;
+            Engine* currentEngine = white ? whiteEngine.get() : blackEngine.get();
+            Ponderer& ponderer = white ? whitePonderer : blackPonderer;
+
+            // Use the ponder search if the opponent played the expected reply
+            Move bestMove;
+            Move expectedReply;
+            SearchLine ponderLine;
+            if (ponderer.ponderHit(*board, ponderLine)) {
+                bestMove = ponderLine.move;
+                if (ponderLine.pv.size() > 1) expectedReply = ponderLine.pv[1];
+            } else {
+                bestMove = currentEngine->chooseMove(*board, &expectedReply);
+            }
             board->makeMove(bestMove);
+            positionChanged();
+
+            // Think on the opponent's time
+            if (!board->moves.empty()) {
+                ponderer.start(*currentEngine, *board, expectedReply);
+            }
             afterMoveProcessing();
         }
     }
@@ -568,6 +594,7 @@ class ChessGame {
               sf::VideoMode(BOARD_SIZE * SQUARE_SIZE, BOARD_SIZE * SQUARE_SIZE),
               "Chess Game") {
         loadAssets();
+        loadOpeningBooks();
         try {
             board = std::make_unique<Board>(
                 "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
@@ -586,34 +613,64 @@ class ChessGame {
         }
     }
 
+    // Frames are only drawn when something changed, and the loop sleeps in
+    // waitEvent unless an engine is due to move
     void run() {
         while (window.isOpen()) {
-            handleEvents();
+            runFrame();
+
+            sf::Event event;
+            if (!engineToMove() && window.waitEvent(event)) {
+                handleEvent(event);
+            }
+        }
+    }
+
+    // One pass of the loop, without the wait for the next event
+    void runFrame() {
+        TRACE_ZONE("ChessGame::frame");
+        handleEvents();
+        if (!showMenu) {
+            checkGameState();
+            if (engineToMove()) {
+                makeEngineMove();
+                checkGameState();
+            }
+        }
+
+        if (needsRedraw) {
+            TRACE_ZONE("ChessGame::render");
             if (showMenu) {
                 drawMenu();
             } else {
-                checkGameState();
-                if (!gameEnded && ((board->colorTurn == 1 && whiteEngine) || (board->colorTurn == -1 && blackEngine))) {
-                    makeEngineMove();
-                }
                 window.clear(sf::Color::White);
                 drawBoard();
                 drawMovingPiece();
                 drawPromotionInterface();
                 window.display();
             }
+            needsRedraw = false;
         }
     }
 
+    bool engineToMove() const {
+        return !showMenu && !gameEnded &&
+               ((board->colorTurn == 1 && whiteEngine) || (board->colorTurn == -1 && blackEngine));
+    }
+
+    // Reads the status the board cached when the last move was made
     void checkGameState() {
+        TRACE_ZONE("ChessGame::checkGameState");
         if (board->isCheckmate()) {
             winner = (board->colorTurn == 1) ? "Black" : "White";
             showMenu = true;
             gameEnded = true;
+            needsRedraw = true;
         } else if (board->isDraw()) {
             isDraw = true;
             showMenu = true;
             gameEnded = true;
+            needsRedraw = true;
         }
     }
 
@@ -628,6 +685,7 @@ void resetBoard() {
         epd = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR";
     }
     board = std::make_unique<Board>(epd);
+    positionChanged();
     isMoving = false;
     gameEnded = false;
     movingPieceIndex = -1;
@@ -653,24 +711,242 @@ void resetBoard() {
 }
 
     void setWhiteEngine(std::unique_ptr<Engine> engine) {
+        whitePonderer.cancel();
         whiteEngine = std::move(engine);
     }
 
     void setBlackEngine(std::unique_ptr<Engine> engine) {
+        blackPonderer.cancel();
         blackEngine = std::move(engine);
     }
 
     std::unique_ptr<Engine> createSelectedEngine() {
+        std::unique_ptr<Engine> engine;
         if (useRandomEngine) {
-            return std::make_unique<RandomEngine>();
+            engine = std::make_unique<RandomEngine>();
         } else {
-            return std::make_unique<BasicEngine>();
+            engine = std::make_unique<BasicEngine>();
+        }
+        for (const auto& book : openingBooks) {
+            engine->addOpeningBook(book);
         }
+        return engine;
     }
 };
 
-int main() {
+static int runAnalysis(const std::string& fen, int depth, int multiPV) {
+    Board board(fen);
+    BasicEngine engine(depth);
+
+    // SEARCH_CACHE names a snapshot reused and updated across runs
+    const char* cachePath = std::getenv("SEARCH_CACHE");
+    std::shared_ptr<SearchCache> cache;
+    if (cachePath) {
+        cache = std::make_shared<SearchCache>();
+        cache->load(cachePath);
+        engine.setSearchCache(cache);
+    }
+
+    std::vector<SearchLine> lines = engine.analyze(board, multiPV);
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const SearchLine& line = lines[i];
+        std::cout << "multipv " << (i + 1) << " depth " << line.depth << " score "
+                  << BasicEngine::formatScore(line.score) << " pv";
+        Board position = board;
+        for (const Move& move : line.pv) {
+            std::cout << ' ' << moveToSAN(position, move);
+            position.makeMove(move);
+        }
+        std::cout << '\n';
+    }
+    std::cout << "nodes " << engine.getNodeCount() << std::endl;
+
+    if (cache) cache->save(cachePath);
+    return 0;
+}
+
+// Headless subcommands, selected by the first command-line argument
+int runCommand(int argc, char* argv[]) {
+    std::string command = argv[1];
+
+    if (command == "uci") {
+        return runUci();
+    } else if (command == "bench") {
+        int depth = 4;
+        int scalingThreads = 0;
+        bool counters = false;
+        NumaPolicy numaPolicy = NumaPolicy::Auto;
+        for (int i = 2; i < argc; ++i) {
+            std::string flag = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (flag == "--scaling" && hasValue) {
+                scalingThreads = std::stoi(argv[++i]);
+            } else if (flag == "--numa" && hasValue) {
+                numaPolicy = parseNumaPolicy(argv[++i]);
+            } else if (flag == "--counters") {
+                counters = true;
+            } else if (i == 2 && flag[0] != '-') {
+                depth = std::stoi(flag);
+            } else {
+                throw std::runtime_error("Unknown bench option " + flag);
+            }
+        }
+        if (scalingThreads > 0) return runScalingBench(depth, scalingThreads, numaPolicy);
+        return runBench(depth, counters);
+    } else if (command == "analyze" && argc >= 3) {
+        int depth = (argc > 3) ? std::stoi(argv[3]) : 5;
+        int multiPV = (argc > 4) ? std::stoi(argv[4]) : 1;
+        return runAnalysis(argv[2], depth, multiPV);
+    } else if (command == "serve") {
+        ServerOptions options;
+        options.threads = std::thread::hardware_concurrency();
+        for (int i = 2; i < argc; ++i) {
+            std::string flag = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (flag == "--threads" && hasValue) {
+                options.threads = std::stoi(argv[++i]);
+            } else if (flag == "--depth" && hasValue) {
+                options.depth = std::stoi(argv[++i]);
+            } else if (flag == "--hash" && hasValue) {
+                options.tableEntries = std::stoull(argv[++i]);
+            } else if (flag == "--socket" && hasValue) {
+                options.socketPath = argv[++i];
+            } else if (flag == "--cache" && hasValue) {
+                options.cachePath = argv[++i];
+            } else if (flag == "--numa" && hasValue) {
+                options.numaPolicy = parseNumaPolicy(argv[++i]);
+            } else if (flag == "--unordered") {
+                options.ordered = false;
+            } else {
+                throw std::runtime_error("Unknown serve option " + flag);
+            }
+        }
+        return runAnalysisServer(options);
+    } else if (command == "perft" && argc >= 4) {
+        PerftOptions options;
+        options.threads = std::thread::hardware_concurrency();
+        for (int i = 4; i < argc; ++i) {
+            std::string flag = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (flag == "--threads" && hasValue) {
+                options.threads = std::stoi(argv[++i]);
+            } else if (flag == "--hash" && hasValue) {
+                options.hashEntries = std::stoull(argv[++i]);
+            } else if (flag == "--split" && hasValue) {
+                options.splitDepth = std::stoi(argv[++i]);
+            } else if (flag == "--chess960") {
+                options.chess960 = true;
+            } else if (flag == "--counters") {
+                options.counters = true;
+            } else {
+                throw std::runtime_error("Unknown perft option " + flag);
+            }
+        }
+        return runPerft(argv[2], std::stoi(argv[3]), options);
+    } else if (command == "perft960") {
+        Chess960SweepOptions options;
+        options.threads = std::thread::hardware_concurrency();
+        if (std::ifstream(CHESS960_PERFT_PATH).good()) options.referencePath = CHESS960_PERFT_PATH;
+        for (int i = 2; i < argc; ++i) {
+            std::string flag = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (flag == "--depth" && hasValue) {
+                options.depth = std::stoi(argv[++i]);
+            } else if (flag == "--threads" && hasValue) {
+                options.threads = std::stoi(argv[++i]);
+            } else if (flag == "--reference" && hasValue) {
+                options.referencePath = argv[++i];
+            } else if (flag == "--write" && hasValue) {
+                options.outputPath = argv[++i];
+            } else if (flag == "--counters") {
+                options.counters = true;
+            } else {
+                throw std::runtime_error("Unknown perft960 option " + flag);
+            }
+        }
+        return runChess960Sweep(options);
+    } else if (command == "movecheck") {
+        int depth = 3;
+        for (int i = 2; i < argc; ++i) {
+            std::string flag = argv[i];
+            if (flag == "--depth" && i + 1 < argc) {
+                depth = std::stoi(argv[++i]);
+            } else {
+                throw std::runtime_error("Unknown movecheck option " + flag);
+            }
+        }
+        return runMoveGenCheck(depth);
+    } else if (command == "pack" && argc == 4) {
+        return convertEPDToPacked(argv[2], argv[3]);
+    } else if (command == "unpack" && argc == 4) {
+        return convertPackedToEPD(argv[2], argv[3]);
+    } else if (command == "datagen" && argc >= 3) {
+        DataGenOptions options;
+        options.outputPath = argv[2];
+        if (argc > 3) options.positions = std::stoull(argv[3]);
+        options.threads = (argc > 4) ? std::stoi(argv[4]) : std::thread::hardware_concurrency();
+        if (argc > 5) options.depth = std::stoi(argv[5]);
+        if (argc > 6) options.gamesPath = argv[6];
+        return runDataGeneration(options);
+    } else if (command == "book" && argc >= 4) {
+        BookBuildOptions options;
+        options.inputPath = argv[2];
+        options.outputPath = argv[3];
+        if (argc > 4) options.maxPlies = std::stoi(argv[4]);
+        if (argc > 5) options.minGames = std::stoi(argv[5]);
+        return buildOpeningBook(options);
+    } else if (command == "tune" && argc >= 4) {
+        TunerOptions options;
+        options.dataPath = argv[2];
+        options.outputPath = argv[3];
+        if (argc > 4) options.epochs = std::stoi(argv[4]);
+        options.threads = (argc > 5) ? std::stoi(argv[5]) : std::thread::hardware_concurrency();
+        return runTuner(options);
+    }
+
+    std::cerr << "Usage: chess [command]\n"
+              << "  uci                        UCI protocol on stdin/stdout\n"
+              << "  bench [depth] [--counters] [--scaling threads] [--numa auto|none|bind]\n"
+              << "                             fixed-depth search signature, or NPS per thread count\n"
+              << "  analyze <fen> [depth] [multipv]\n"
+              << "                             best lines for a position\n"
+              << "  serve [--threads N] [--depth N] [--hash entries] [--unordered]\n"
+              << "        [--socket path] [--cache prefix] [--numa auto|none|bind]\n"
+              << "                             batch analysis of FEN/JSON lines to JSON lines\n"
+              << "  perft <fen> <depth> [--threads N] [--hash entries] [--split depth] [--chess960]\n"
+              << "        [--counters]\n"
+              << "                             count legal move paths, divided by root move\n"
+              << "  perft960 [--depth N] [--threads N] [--reference file] [--write file] [--counters]\n"
+              << "                             perft every Chess960 start against a reference table\n"
+              << "  movecheck [--depth N]      check the move generators against making each move\n"
+              << "  pack <in.epd> <out.bin>    convert EPD/FEN lines to packed positions\n"
+              << "  unpack <in.bin> <out.epd>  convert packed positions to FEN lines\n"
+              << "  datagen <out.bin> [positions] [threads] [depth] [games.pgn]\n"
+              << "                             self-play training data from Chess960 openings\n"
+              << "  book <games.pgn> <out.bin> [plies] [min games]\n"
+              << "                             build an opening book from PGN games\n"
+              << "  tune <data.bin> <out.hpp> [epochs] [threads]\n"
+              << "                             fit evaluation weights to training data\n"
+              << "With no command the graphical game starts." << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
     try {
+        // Syzygy tables are optional and configured from the environment
+        if (const char* syzygyPath = std::getenv("SYZYGY_PATH")) {
+            const char* limit = std::getenv("SYZYGY_PROBE_LIMIT");
+            if (initTablebases(syzygyPath, limit ? std::atoi(limit) : 7)) {
+                // stderr, so serve's JSON lines and the UCI handshake stay clean
+                std::cerr << "Syzygy tablebases up to " << tablebasePieceLimit() << " pieces" << std::endl;
+            }
+        }
+
+        if (argc > 1) {
+            return runCommand(argc, argv);
+        }
+
         ChessGame game;
         game.run();
     } catch (const std::exception& e) {